@@ -0,0 +1,357 @@
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "columnar.hpp"
+#include "format.hpp"
+#include "lib.hpp"
+#include "schema.hpp"
+#include "serialize.hpp"
+#include "internal/scanner.hpp"
+
+// Every allocation in the process goes through these so benchmarks can report allocations per
+// document and the peak number of live heap bytes.
+
+static std::atomic<std::size_t> allocations{0};
+static std::atomic<std::size_t> live_bytes{0};
+static std::atomic<std::size_t> peak_bytes{0};
+
+// Large enough to keep the returned pointer aligned for any fundamental type.
+static constexpr std::size_t HEADER = alignof(std::max_align_t);
+
+void *operator new(std::size_t size)
+{
+    auto block = static_cast<char *>(std::malloc(size + HEADER));
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<std::size_t *>(block) = size;
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    auto peak = peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+
+    return block + HEADER;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (!p)
+    {
+        return;
+    }
+    auto block = static_cast<char *>(p) - HEADER;
+    live_bytes.fetch_sub(*reinterpret_cast<std::size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+enum CorpusKind
+{
+    NumericArray,
+    StringLogs,
+    DeeplyNested,
+    WideObject,
+    Ndjson,
+};
+
+/**
+ * A set of documents that are processed together in one benchmark iteration. Every corpus but
+ * NDJSON is a single document.
+ */
+struct Corpus
+{
+    std::vector<std::string> documents;
+    std::size_t bytes = 0;
+};
+
+static std::string random_word(std::mt19937 &rng)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    auto length = std::uniform_int_distribution<int>(3, 12)(rng);
+    auto word = std::string();
+    for (int i = 0; i < length; ++i)
+    {
+        word.push_back(letters[std::uniform_int_distribution<int>(0, 25)(rng)]);
+    }
+    return word;
+}
+
+static std::string log_record(std::mt19937 &rng, int i)
+{
+    auto message = std::string();
+    for (int w = 0; w < 12; ++w)
+    {
+        message += random_word(rng) + " ";
+    }
+    return "{\"ts\": " + std::to_string(1700000000 + i) + ", \"level\": \"info\", \"service\": \"" + random_word(rng) +
+           "\", \"message\": \"" + message + "\", \"meta\": {\"trace_id\": \"" + random_word(rng) + random_word(rng) +
+           "\", \"retry\": false, \"tags\": [\"" + random_word(rng) + "\", \"" + random_word(rng) + "\"]}}";
+}
+
+static Corpus generate(CorpusKind kind)
+{
+    // Fixed seed so results are comparable between runs and releases.
+    auto rng = std::mt19937(42);
+    auto corpus = Corpus();
+
+    switch (kind)
+    {
+    case NumericArray:
+    {
+        auto values = std::uniform_real_distribution<double>(-1e6, 1e6);
+        auto s = std::string("[");
+        for (int i = 0; i < 50000; ++i)
+        {
+            s += (i ? ", " : "") + std::to_string(values(rng));
+        }
+        corpus.documents.push_back(s + "]");
+        break;
+    }
+    case StringLogs:
+    {
+        auto s = std::string("[");
+        for (int i = 0; i < 3000; ++i)
+        {
+            s += (i ? ",\n" : "") + log_record(rng, i);
+        }
+        corpus.documents.push_back(s + "]");
+        break;
+    }
+    case DeeplyNested:
+    {
+        auto s = std::string("[");
+        for (int i = 0; i < 200; ++i)
+        {
+            s += i ? ", " : "";
+            for (int depth = 0; depth < 100; ++depth)
+            {
+                s += depth % 2 ? "[" : "{\"" + random_word(rng) + "\": ";
+            }
+            s += "1";
+            for (int depth = 99; depth >= 0; --depth)
+            {
+                s += depth % 2 ? "]" : "}";
+            }
+        }
+        corpus.documents.push_back(s + "]");
+        break;
+    }
+    case WideObject:
+    {
+        auto s = std::string("{");
+        for (int i = 0; i < 20000; ++i)
+        {
+            s += (i ? ", \"" : "\"") + random_word(rng) + std::to_string(i) + "\": " + (i % 3 ? std::to_string(i) : "\"" + random_word(rng) + "\"");
+        }
+        corpus.documents.push_back(s + "}");
+        break;
+    }
+    case Ndjson:
+        for (int i = 0; i < 3000; ++i)
+        {
+            corpus.documents.push_back(log_record(rng, i));
+        }
+        break;
+    }
+
+    for (const auto &document : corpus.documents)
+    {
+        corpus.bytes += document.size();
+    }
+    return corpus;
+}
+
+static const Corpus &corpus(CorpusKind kind)
+{
+    static const Corpus corpora[] = {
+        generate(NumericArray),
+        generate(StringLogs),
+        generate(DeeplyNested),
+        generate(WideObject),
+        generate(Ndjson),
+    };
+    return corpora[kind];
+}
+
+/**
+ * Runs op over every document of the corpus once per iteration and reports throughput,
+ * allocations per document and the peak live heap bytes reached during the benchmark.
+ */
+template <typename TOp>
+static void run(benchmark::State &state, const Corpus &corpus, TOp op)
+{
+    auto baseline = live_bytes.load();
+    peak_bytes.store(baseline);
+    auto allocations_before = allocations.load();
+
+    for (auto _ : state)
+    {
+        for (const auto &document : corpus.documents)
+        {
+            op(document);
+        }
+    }
+
+    auto documents = static_cast<double>(state.iterations() * corpus.documents.size());
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.bytes));
+    state.counters["allocs_per_doc"] = static_cast<double>(allocations.load() - allocations_before) / documents;
+    state.counters["peak_heap_bytes"] = static_cast<double>(peak_bytes.load() - baseline);
+}
+
+static void BM_Parse(benchmark::State &state, CorpusKind kind)
+{
+    run(state, corpus(kind), [](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::JsonValue::parse(document)); });
+}
+
+static void BM_ParsePacked(benchmark::State &state, CorpusKind kind)
+{
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+    run(state, corpus(kind), [&](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::JsonValue::parse(document, options)); });
+}
+
+static void BM_Validate(benchmark::State &state, CorpusKind kind)
+{
+    run(state, corpus(kind), [](const std::string &document)
+        {
+            auto tokenizer = jsonpp::scan::Tokenizer(document);
+            while (tokenizer.next().type != jsonpp::scan::End)
+            {
+            } });
+}
+
+static const char *LOG_SCHEMA = R"({"type": "array", "items": {
+    "type": "object",
+    "required": ["ts", "level", "service"],
+    "properties": {
+        "ts": {"type": "integer", "minimum": 0},
+        "level": {"enum": ["debug", "info", "warn", "error"]},
+        "service": {"type": "string", "maxLength": 64},
+        "meta": {"type": "object", "properties": {"retry": {"type": "boolean"}, "tags": {"items": {"type": "string"}}}}
+    }
+}})";
+
+static void BM_SchemaValidate(benchmark::State &state, CorpusKind kind)
+{
+    auto schema = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(LOG_SCHEMA));
+    run(state, corpus(kind), [&](const std::string &document)
+        { schema.scan(std::string_view(document)); });
+}
+
+static void BM_ParseSchema(benchmark::State &state, CorpusKind kind)
+{
+    auto schema = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(LOG_SCHEMA));
+    auto options = jsonpp::ParseOptions{};
+    options.schema = &schema;
+    run(state, corpus(kind), [&](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::JsonValue::parse(document, options)); });
+}
+
+static void BM_Serialize(benchmark::State &state, CorpusKind kind)
+{
+    auto values = std::vector<jsonpp::JsonValue>();
+    for (const auto &document : corpus(kind).documents)
+    {
+        values.push_back(jsonpp::JsonValue::parse(document));
+    }
+
+    auto i = std::size_t(0);
+    run(state, corpus(kind), [&](const std::string &)
+        { benchmark::DoNotOptimize(values[i++ % values.size()].json()); });
+}
+
+static void BM_SerializeStream(benchmark::State &state, CorpusKind kind)
+{
+    auto values = std::vector<jsonpp::JsonValue>();
+    for (const auto &document : corpus(kind).documents)
+    {
+        values.push_back(jsonpp::JsonValue::parse(document));
+    }
+
+    // The sink only looks at the chunks, so peak_heap_bytes is the serializer's own memory.
+    auto i = std::size_t(0);
+    run(state, corpus(kind), [&](const std::string &)
+        {
+            auto serializer = jsonpp::serialize::Serializer(values[i++ % values.size()], [](std::string_view chunk)
+                                                            {
+                                                                benchmark::DoNotOptimize(chunk.data());
+                                                                return chunk.size(); });
+            serializer.write(); });
+}
+
+static void BM_Minify(benchmark::State &state, CorpusKind kind)
+{
+    run(state, corpus(kind), [](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::format::minify(document)); });
+}
+
+static void BM_Pretty(benchmark::State &state, CorpusKind kind)
+{
+    run(state, corpus(kind), [](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::format::pretty(document)); });
+}
+
+static void BM_Columnar(benchmark::State &state, CorpusKind kind)
+{
+    auto columns = std::vector<jsonpp::columnar::ColumnSpec>{
+        {"ts", jsonpp::columnar::NumberType},
+        {"level", jsonpp::columnar::StringType},
+        {"service", jsonpp::columnar::StringType},
+    };
+    run(state, corpus(kind), [&](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::columnar::extract(document, columns)); });
+}
+
+static void BM_ParseCached(benchmark::State &state, CorpusKind kind)
+{
+    // Documents that fit in a shard are hits after the first iteration.
+    auto cache = jsonpp::cache::ParseCache();
+    run(state, corpus(kind), [&](const std::string &document)
+        { benchmark::DoNotOptimize(cache.parse(document)); });
+}
+
+static void BM_RoundTrip(benchmark::State &state, CorpusKind kind)
+{
+    run(state, corpus(kind), [](const std::string &document)
+        { benchmark::DoNotOptimize(jsonpp::JsonValue::parse(jsonpp::JsonValue::parse(document).json())); });
+}
+
+#define JSONPP_BENCH_CORPORA(fn)                            \
+    BENCHMARK_CAPTURE(fn, numeric_array, NumericArray);     \
+    BENCHMARK_CAPTURE(fn, string_logs, StringLogs);         \
+    BENCHMARK_CAPTURE(fn, deeply_nested, DeeplyNested);     \
+    BENCHMARK_CAPTURE(fn, wide_object, WideObject);         \
+    BENCHMARK_CAPTURE(fn, ndjson, Ndjson)
+
+JSONPP_BENCH_CORPORA(BM_Parse);
+JSONPP_BENCH_CORPORA(BM_Validate);
+JSONPP_BENCH_CORPORA(BM_ParseCached);
+JSONPP_BENCH_CORPORA(BM_Serialize);
+JSONPP_BENCH_CORPORA(BM_SerializeStream);
+JSONPP_BENCH_CORPORA(BM_RoundTrip);
+JSONPP_BENCH_CORPORA(BM_Minify);
+JSONPP_BENCH_CORPORA(BM_Pretty);
+BENCHMARK_CAPTURE(BM_ParsePacked, numeric_array, NumericArray);
+// The only corpus that is an array of records.
+BENCHMARK_CAPTURE(BM_Columnar, string_logs, StringLogs);
+BENCHMARK_CAPTURE(BM_SchemaValidate, string_logs, StringLogs);
+BENCHMARK_CAPTURE(BM_ParseSchema, string_logs, StringLogs);
+
+BENCHMARK_MAIN();
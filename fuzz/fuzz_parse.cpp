@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "lib.hpp"
+
+// libFuzzer target for JsonValue::parse and the round trip through json().
+//
+// Built with JSONPP_FUZZ_COMPLEXITY, the target instead checks that parse time stays linear in
+// the input size. A linear parser spends a bounded amount of time per input byte no matter what
+// the input looks like, while a superlinear one spends more per byte as inputs grow. Every input
+// is timed against the per-byte cost of a reference document measured at startup, and inputs
+// that are far slower per byte are reported as crashes so libFuzzer saves and minimizes them.
+//
+// Built with JSONPP_FUZZ_STANDALONE, main() runs the target over the files named on the command
+// line, which is useful for reproducing crashes without libFuzzer.
+
+#ifdef JSONPP_FUZZ_COMPLEXITY
+
+// Inputs smaller than this are dominated by fixed costs and timer noise.
+static constexpr std::size_t MIN_SIZE = 4096;
+// How many times slower per byte than the reference an input may be.
+static constexpr double MAX_SLOWDOWN = 25.0;
+
+static double parse_ns_per_byte(std::string_view input)
+{
+    // Best of a few runs to filter out scheduling noise.
+    auto best = std::chrono::nanoseconds::max();
+    for (int run = 0; run < 3; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            jsonpp::JsonValue::parse(input);
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+        best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+    }
+    return static_cast<double>(best.count()) / static_cast<double>(input.size());
+}
+
+static double reference_ns_per_byte()
+{
+    auto reference = std::string("[");
+    for (int i = 0; i < 2000; ++i)
+    {
+        reference += (i ? ", " : "") + std::string("{\"id\": ") + std::to_string(i) + ", \"name\": \"item\", \"tags\": [true, null, 1.5e3]}";
+    }
+    reference += "]";
+    return parse_ns_per_byte(reference);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size)
+{
+    static const double reference = reference_ns_per_byte();
+
+    if (size < MIN_SIZE)
+    {
+        return 0;
+    }
+
+    auto input = std::string_view(reinterpret_cast<const char *>(data), size);
+    auto ns_per_byte = parse_ns_per_byte(input);
+    if (ns_per_byte > MAX_SLOWDOWN * reference)
+    {
+        std::fprintf(stderr, "Superlinear parse: %.1f ns/byte for %zu bytes, reference is %.1f ns/byte\n", ns_per_byte, size, reference);
+        std::abort();
+    }
+    return 0;
+}
+
+#else
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size)
+{
+    auto input = std::string_view(reinterpret_cast<const char *>(data), size);
+
+    std::optional<jsonpp::JsonValue> value;
+    try
+    {
+        value = jsonpp::JsonValue::parse(input);
+    }
+    catch (const std::runtime_error &)
+    {
+        return 0;
+    }
+
+    // Anything that parses must serialize to JSON that parses back to the same value.
+    auto json = value->json();
+    try
+    {
+        // NaN never comes out of the parser, and json() writes non-finite numbers as null.
+        if (!jsonpp::JsonValue::parse(json).equals(value.value()))
+        {
+            std::fprintf(stderr, "Round trip changed the value: %s\n", json.c_str());
+            std::abort();
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::fprintf(stderr, "Round trip output does not parse (%s): %s\n", e.what(), json.c_str());
+        std::abort();
+    }
+    return 0;
+}
+
+#endif
+
+#ifdef JSONPP_FUZZ_STANDALONE
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        auto file = std::ifstream(argv[i], std::ios::binary);
+        auto input = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(input.data()), input.size());
+        std::fprintf(stderr, "%s: ok\n", argv[i]);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+#ifndef __cpp_impl_coroutine
+#error "async.hpp requires C++20 coroutines, configure with -DJSONPP_CXX20=ON"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "lib.hpp"
+
+namespace jsonpp::async
+{
+
+    /**
+     * A lazily started coroutine producing a T.
+     *
+     * Awaiting a Task from another coroutine starts it and resumes the awaiting coroutine once it
+     * completes. Code outside of coroutines, like the top of an event loop, can call start() instead
+     * and pick up the result with get() once done() is true.
+     */
+    template <typename T>
+    class Task
+    {
+    public:
+        struct promise_type;
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+            {
+                auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        struct promise_type
+        {
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void return_value(T value) { this->result.emplace(std::move(value)); }
+            void unhandled_exception() { this->error = std::current_exception(); }
+
+            std::optional<T> result;
+            std::exception_ptr error;
+            std::coroutine_handle<> continuation;
+        };
+
+        Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+        Task &operator=(Task &&other) noexcept
+        {
+            std::swap(this->m_handle, other.m_handle);
+            return *this;
+        }
+
+        ~Task()
+        {
+            if (this->m_handle)
+            {
+                this->m_handle.destroy();
+            }
+        }
+
+        Task() = delete;
+
+        bool await_ready() const noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            this->m_handle.promise().continuation = awaiting;
+            return this->m_handle;
+        }
+
+        T await_resume() { return this->get(); }
+
+        /**
+         * Runs the task until its first suspension point.
+         */
+        void start() { this->m_handle.resume(); }
+
+        bool done() const { return this->m_handle.done(); }
+
+        /**
+         * @return the result of a task that is done. Rethrows the exception the task ended with.
+         */
+        T get()
+        {
+            auto &promise = this->m_handle.promise();
+            if (promise.error)
+            {
+                std::rethrow_exception(promise.error);
+            }
+            return std::move(promise.result.value());
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    /**
+     * Parses a document read from an asynchronous byte source.
+     *
+     * The source must have a next() member whose result can be co_awaited and yields the next chunk
+     * of input as anything convertible to std::string_view, with an empty chunk marking the end of
+     * input. A chunk only needs to stay valid until next() is called again. Input is fed to a Parser
+     * as it arrives, so the coroutine never blocks: when a chunk is used up it suspends on the source,
+     * with the partial document held on the parser's stack, and resumes where it left off.
+     *
+     * @param source must outlive the returned task.
+     * @return a task producing the parsed document. It fails with std::runtime_error like
+     * JsonValue::parse.
+     */
+    template <typename Source>
+    Task<JsonValue> parse(Source &source, ParseOptions options = ParseOptions{})
+    {
+        auto parser = Parser(options);
+        while (1)
+        {
+            auto chunk = co_await source.next();
+            auto view = std::string_view(chunk);
+            if (view.empty())
+            {
+                co_return parser.finish();
+            }
+            parser.feed(view);
+        }
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "lib.hpp"
+
+namespace jsonpp::cache
+{
+
+    struct CacheOptions
+    {
+        // Upper bound on the bytes charged for cached documents, see ParseCache for how they are
+        // counted. Split evenly between the shards.
+        std::size_t max_bytes = 64 * 1024 * 1024;
+        // Number of independently locked parts of the cache. Threads only contend when their
+        // documents hash to the same shard.
+        std::size_t shards = 16;
+        // Options every document is parsed with.
+        ParseOptions parse_options;
+    };
+
+    struct CacheStats
+    {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t entries = 0;
+        // Bytes currently charged for the cached documents.
+        std::size_t bytes = 0;
+    };
+
+    /**
+     * A thread-safe cache of parsed documents, keyed by their text.
+     *
+     * Documents are looked up by a 64-bit hash of their text and confirmed by comparing the text
+     * itself, so a hash collision costs a parse but never returns the wrong document. Each shard is
+     * a least recently used list behind its own mutex, picked by the hash. Parsing happens outside
+     * of the lock, so two threads that miss on the same text at once may both parse it; the first
+     * one to finish is kept.
+     *
+     * Every document is charged for its text, which is kept for comparing, plus the estimated size
+     * of its tree, counted like ParseOptions::max_allocation. When a shard goes over its share of
+     * max_bytes it evicts its least recently used documents. A document that alone exceeds the
+     * share of a shard is parsed and returned but not cached. Evicted documents stay alive for as
+     * long as a returned JsonValue refers to them, and that memory is not charged to the cache.
+     *
+     * Returned values share their nodes with the cache. They are safe to read from any thread, and
+     * changing one through mutable_value copies the nodes it changes rather than touching the cached
+     * document.
+     */
+    class ParseCache
+    {
+    public:
+        /**
+         * Throws std::runtime_error if options has no shards.
+         */
+        explicit ParseCache(CacheOptions options = CacheOptions{});
+        ~ParseCache();
+
+        ParseCache(const ParseCache &) = delete;
+        ParseCache &operator=(const ParseCache &) = delete;
+
+        /**
+         * Returns the cached document for json_str, parsing and caching it if there is none.
+         *
+         * @return the parsed document. Throws std::runtime_error if json_str is not valid JSON, and
+         * then caches nothing.
+         */
+        JsonValue parse(std::string_view json_str);
+
+        /**
+         * @return the counters of every shard added up.
+         */
+        CacheStats stats() const;
+
+        /**
+         * Drops every cached document. Counters other than entries and bytes are kept.
+         */
+        void clear();
+
+    private:
+        struct Shard;
+
+        CacheOptions m_options;
+        std::unique_ptr<Shard[]> m_shards;
+    };
+
+}
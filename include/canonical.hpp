@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "lib.hpp"
+
+namespace jsonpp::canonical
+{
+
+    using Digest = std::array<std::uint8_t, 32>;
+
+    /**
+     * Serializes a JsonValue with the JSON Canonicalization Scheme (RFC 8785), so that equal
+     * documents always produce the same bytes.
+     *
+     * Object members are sorted by the UTF-16 code units of their decoded names. Only references to
+     * the member values are sorted, the values themselves are never copied. Numbers are written like
+     * ECMAScript's Number.prototype.toString, and strings are unescaped and then re-escaped minimally.
+     *
+     * @return the canonical JSON text. Throws std::runtime_error if the value holds a NaN or infinite
+     * number, or a string that is not valid UTF-8 or has an unpaired surrogate escape.
+     */
+    std::string serialize(const JsonValue &value);
+
+    /**
+     * Streams the canonical JSON text to a sink in chunks instead of building it in memory.
+     *
+     * @param sink called with consecutive chunks of the output. A chunk is only valid during the call.
+     */
+    void serialize(const JsonValue &value, const std::function<void(std::string_view)> &sink);
+
+    /**
+     * Computes the SHA-256 digest of the canonical JSON text without building it, for use as a
+     * content address.
+     *
+     * @return the digest. Throws std::runtime_error like serialize.
+     */
+    Digest digest(const JsonValue &value);
+
+}
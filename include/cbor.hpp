@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::cbor
+{
+
+    /**
+     * Encodes a JsonValue as CBOR (RFC 8949).
+     *
+     * Numbers that are integers are written as CBOR integers, other numbers as the smallest float
+     * that represents them exactly, and NaN and infinity are written as null like JsonValue::json
+     * does. Strings are carried as they are stored in the JsonValue, escapes included, so decoding
+     * reproduces the same JsonValue without any escaping or number formatting. The exception is a
+     * raw control character, which JsonValue::parse accepts in a string but decode escapes.
+     *
+     * @return the encoded bytes.
+     */
+    std::vector<std::uint8_t> encode(const JsonValue &value);
+
+    /**
+     * Decodes a single CBOR data item into a JsonValue.
+     *
+     * Integers and floats become numbers, text strings become strings, and maps must have text
+     * string keys. Tags are ignored and undefined decodes as null. Byte strings, NaN and infinity
+     * have no JSON equivalent and are rejected.
+     *
+     * Text is taken in the escaped form encode writes: escapes are kept, while quotes and control
+     * characters are escaped. A backslash that does not start a valid JSON escape is rejected.
+     *
+     * @param options only max_depth applies.
+     * @return the decoded value. Throws std::runtime_error if the input is not valid CBOR, cannot
+     * be represented as JSON, nests deeper than options.max_depth, or has trailing bytes.
+     */
+    JsonValue decode(const std::uint8_t *data, std::size_t size, const ParseOptions &options = ParseOptions{});
+    JsonValue decode(const std::vector<std::uint8_t> &data, const ParseOptions &options = ParseOptions{});
+
+    /**
+     * Converts JSON text straight to CBOR without building a JsonValue.
+     *
+     * Arrays and objects are written as indefinite-length items since their sizes are not known
+     * up front. decode(transcode(json_str)) equals JsonValue::parse(json_str), except that raw
+     * control characters in strings come back escaped, as they do from encode.
+     *
+     * @return the encoded bytes. Throws std::runtime_error if json_str is not valid JSON.
+     */
+    std::vector<std::uint8_t> transcode(std::string_view json_str);
+
+}
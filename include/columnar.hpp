@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::columnar
+{
+
+    enum ColumnType
+    {
+        NumberType,
+        StringType,
+        BoolType,
+    };
+
+    /**
+     * A member to extract from every record.
+     *
+     * name is compared with object keys as written in the document, escapes included.
+     */
+    struct ColumnSpec
+    {
+        std::string name;
+        ColumnType type;
+    };
+
+    struct NumberColumn
+    {
+        std::vector<double> values;
+    };
+
+    /**
+     * Strings of every row stored back to back. Row i is blob[offsets[i], offsets[i + 1]), as written
+     * in the document, escapes included.
+     */
+    struct StringColumn
+    {
+        std::string blob;
+        std::vector<std::size_t> offsets{0};
+
+        std::string_view at(std::size_t row) const
+        {
+            return std::string_view(this->blob).substr(this->offsets[row], this->offsets[row + 1] - this->offsets[row]);
+        }
+    };
+
+    struct BoolColumn
+    {
+        // One byte per row rather than std::vector<bool>, so rows can be read without bit twiddling.
+        std::vector<std::uint8_t> values;
+    };
+
+    using ColumnValues = std::variant<NumberColumn, StringColumn, BoolColumn>;
+
+    /**
+     * One extracted member. Every vector holds exactly one entry per row. Rows where the member is
+     * missing or null hold 0, an empty string or false, and are marked in valid.
+     */
+    struct Column
+    {
+        std::string name;
+        ColumnValues values;
+        // 1 if the row had the member, 0 if it was missing or null.
+        std::vector<std::uint8_t> valid;
+    };
+
+    struct Table
+    {
+        std::size_t rows = 0;
+        // In the order of the specs they were extracted with.
+        std::vector<Column> columns;
+    };
+
+    /**
+     * Pivots an array of objects into one contiguous column per requested member, straight from raw
+     * JSON text.
+     *
+     * No JsonValue or JsonObject is built: each record is tokenized, requested members are appended to
+     * their column and every other member is skipped by bracket matching, so skipped subtrees are not
+     * fully validated. Records of the same shape are matched against the specs in the order their
+     * members were last seen, which takes one comparison per member. If a record repeats a member the
+     * first occurrence is kept, like JsonValue::parse.
+     *
+     * @param json_str a JSON array whose elements are all objects.
+     * @param columns the members to extract and their types.
+     * @return the extracted columns. Throws std::runtime_error if the input is malformed, an element is
+     * not an object, or a requested member has a value of another type.
+     */
+    Table extract(std::string_view json_str, const std::vector<ColumnSpec> &columns);
+
+    /**
+     * Pivots a parsed array of objects, with the same rules as extract. Named apart from it because
+     * JsonValue converts from std::string.
+     */
+    Table pivot(const JsonValue &array, const std::vector<ColumnSpec> &columns);
+
+}
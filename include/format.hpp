@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jsonpp::format
+{
+
+    struct FormatOptions
+    {
+        // Print every member and element on its own line with nested containers indented, and a space
+        // after colons. Otherwise all whitespace outside of strings is removed.
+        bool pretty = false;
+        // Written once per nesting level in front of each line when pretty printing.
+        std::string indent = "    ";
+    };
+
+    /**
+     * Reformats JSON text as it is fed in chunks, without building a JsonValue.
+     *
+     * Only the stack of open containers is kept between chunks, so memory use is proportional to the
+     * nesting depth no matter how large the document is, and chunks may split the input anywhere,
+     * including inside strings and escapes. Strings and scalars are copied through exactly as written.
+     *
+     * Brackets must match, commas and colons must be where JSON puts them, and strings must be
+     * terminated, otherwise std::runtime_error is thrown. Scalars themselves are not validated, the
+     * input is expected to be JSON already.
+     */
+    class Formatter
+    {
+    public:
+        /**
+         * @param sink called with consecutive chunks of the output. A chunk is only valid during the
+         * call.
+         */
+        Formatter(FormatOptions options, std::function<void(std::string_view)> sink)
+            : m_options(std::move(options)), m_sink(std::move(sink)) {}
+
+        Formatter() = delete;
+
+        /**
+         * Reformats the next chunk of input. Output is handed to the sink once enough of it has
+         * accumulated.
+         */
+        void feed(std::string_view chunk);
+
+        /**
+         * Checks that the document is complete and hands the rest of the output to the sink.
+         */
+        void finish();
+
+    private:
+        enum Expect
+        {
+            ExpectValueOrEnd,
+            ExpectValue,
+            ExpectCommaOrEnd,
+            ExpectKeyOrEnd,
+            ExpectKey,
+            ExpectColon,
+        };
+
+        struct Frame
+        {
+            // Closing bracket of the container.
+            char close;
+            Expect expect;
+        };
+
+        void open_line(std::size_t depth);
+        void open_pending();
+        void before_value();
+        void flush(bool all);
+
+        FormatOptions m_options;
+        std::function<void(std::string_view)> m_sink;
+        std::string m_out;
+        // Every open container.
+        std::vector<Frame> m_stack;
+        bool m_in_string = false;
+        bool m_escape = false;
+        // A number or literal was cut off by the end of the last chunk.
+        bool m_in_scalar = false;
+        // A container was just opened, its first line is written once its first value shows up.
+        bool m_pending_open = false;
+        // The top-level value is complete or, for scalars, started. Only whitespace may follow.
+        bool m_done = false;
+    };
+
+    /**
+     * @return json_str with all whitespace outside of strings removed.
+     */
+    std::string minify(std::string_view json_str);
+
+    /**
+     * @return json_str with one member or element per line, indented by indent per nesting level.
+     */
+    std::string pretty(std::string_view json_str, std::string indent = "    ");
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::incremental
+{
+
+    /**
+     * A parsed document that is kept up to date as its text is edited.
+     *
+     * Next to the value, the document keeps the byte span of every array and object. An edit only
+     * re-parses the smallest container that encloses it, and the result replaces that container in
+     * the value. The nodes on the path to it are copied, and every other node is shared with the
+     * previous value. An edit that touches the brackets of every enclosing container, or that leaves
+     * the enclosing container unable to parse on its own, falls back to parsing the whole document.
+     *
+     * Spans are stored relative to their parent, so an edit only shifts the spans of the later
+     * siblings of each container on the path to it.
+     */
+    class Document
+    {
+    public:
+        /**
+         * Parses a document.
+         *
+         * @return the parsed document. Throws std::runtime_error if the text is not valid JSON.
+         */
+        static Document parse(std::string text);
+
+        /**
+         * Replaces length bytes at offset with replacement and brings the value up to date.
+         *
+         * Throws std::runtime_error if the edit is out of range or the edited text is not valid JSON,
+         * and then leaves the document unchanged.
+         */
+        void edit(std::size_t offset, std::size_t length, std::string_view replacement);
+
+        const std::string &text() const { return this->m_text; }
+        const JsonValue &value() const { return this->m_value; }
+
+        /**
+         * @return the number of bytes parsed by the last edit, or by parse if there was none.
+         */
+        std::size_t parsed_bytes() const { return this->m_parsed_bytes; }
+
+        /**
+         * The span of a container value.
+         */
+        struct Span
+        {
+            // Start relative to the start of the parent container, or of the text for the root.
+            std::size_t offset;
+            std::size_t length;
+            // Member name, as written, or element index of the value in its parent.
+            std::string key;
+            std::size_t index;
+            // Spans of the children that are containers, in document order.
+            std::vector<Span> children;
+        };
+
+    private:
+        Document(std::string text, JsonValue value, Span root, std::size_t parsed_bytes)
+            : m_text(std::move(text)), m_value(std::move(value)), m_root(std::move(root)), m_parsed_bytes(parsed_bytes) {}
+
+        std::string m_text;
+        JsonValue m_value;
+        Span m_root;
+        std::size_t m_parsed_bytes;
+    };
+
+}
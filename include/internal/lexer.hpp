@@ -0,0 +1,201 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace jsonpp::lex
+{
+
+    /**
+     * Character classes of the number grammar.
+     */
+    enum NumberClass : std::uint8_t
+    {
+        ClassZero,
+        ClassDigit,
+        ClassMinus,
+        ClassPlus,
+        ClassDot,
+        ClassExponent,
+        ClassOther,
+        NumberClassCount,
+    };
+
+    /**
+     * States of the number DFA, named after the last part of the number that was read.
+     */
+    enum NumberState : std::uint8_t
+    {
+        NumberStart,
+        NumberSign,
+        NumberZero,
+        NumberInteger,
+        NumberDot,
+        NumberFraction,
+        NumberExponent,
+        NumberExponentSign,
+        NumberExponentDigits,
+        NumberStateCount,
+
+        // Results of a transition that are not states: the character is not part of the number, or
+        // cannot appear at this point of one.
+        NumberEnd = NumberStateCount,
+        NumberInvalid,
+    };
+
+    enum CharFlag : std::uint8_t
+    {
+        WhitespaceFlag = 1 << 0,
+        HexFlag = 1 << 1,
+        // May follow a backslash in a string.
+        EscapeFlag = 1 << 2,
+    };
+
+    constexpr bool number_accepting(NumberState state)
+    {
+        return state == NumberZero || state == NumberInteger || state == NumberFraction || state == NumberExponentDigits;
+    }
+
+    constexpr std::array<NumberClass, 256> make_number_classes()
+    {
+        auto classes = std::array<NumberClass, 256>();
+        for (auto &c : classes)
+        {
+            c = ClassOther;
+        }
+        classes['0'] = ClassZero;
+        for (auto c = '1'; c <= '9'; ++c)
+        {
+            classes[c] = ClassDigit;
+        }
+        classes['-'] = ClassMinus;
+        classes['+'] = ClassPlus;
+        classes['.'] = ClassDot;
+        classes['e'] = ClassExponent;
+        classes['E'] = ClassExponent;
+        return classes;
+    }
+
+    constexpr std::array<std::array<NumberState, NumberClassCount>, NumberStateCount> make_number_transitions()
+    {
+        auto table = std::array<std::array<NumberState, NumberClassCount>, NumberStateCount>();
+        for (std::size_t state = 0; state < NumberStateCount; ++state)
+        {
+            // Anything unexpected ends a complete number and is an error in an incomplete one.
+            for (auto &next : table[state])
+            {
+                next = number_accepting(static_cast<NumberState>(state)) ? NumberEnd : NumberInvalid;
+            }
+        }
+
+        table[NumberStart][ClassMinus] = NumberSign;
+        table[NumberStart][ClassZero] = NumberZero;
+        table[NumberStart][ClassDigit] = NumberInteger;
+
+        table[NumberSign][ClassZero] = NumberZero;
+        table[NumberSign][ClassDigit] = NumberInteger;
+
+        table[NumberZero][ClassDot] = NumberDot;
+        table[NumberZero][ClassExponent] = NumberExponent;
+
+        table[NumberInteger][ClassZero] = NumberInteger;
+        table[NumberInteger][ClassDigit] = NumberInteger;
+        table[NumberInteger][ClassDot] = NumberDot;
+        table[NumberInteger][ClassExponent] = NumberExponent;
+
+        table[NumberDot][ClassZero] = NumberFraction;
+        table[NumberDot][ClassDigit] = NumberFraction;
+
+        table[NumberFraction][ClassZero] = NumberFraction;
+        table[NumberFraction][ClassDigit] = NumberFraction;
+        table[NumberFraction][ClassExponent] = NumberExponent;
+
+        table[NumberExponent][ClassZero] = NumberExponentDigits;
+        table[NumberExponent][ClassDigit] = NumberExponentDigits;
+        table[NumberExponent][ClassMinus] = NumberExponentSign;
+        table[NumberExponent][ClassPlus] = NumberExponentSign;
+
+        table[NumberExponentSign][ClassZero] = NumberExponentDigits;
+        table[NumberExponentSign][ClassDigit] = NumberExponentDigits;
+
+        table[NumberExponentDigits][ClassZero] = NumberExponentDigits;
+        table[NumberExponentDigits][ClassDigit] = NumberExponentDigits;
+
+        return table;
+    }
+
+    constexpr std::array<std::uint8_t, 256> make_char_flags()
+    {
+        auto flags = std::array<std::uint8_t, 256>();
+        for (auto c : {' ', '\t', '\n', '\r'})
+        {
+            flags[c] |= WhitespaceFlag;
+        }
+        for (auto c : {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f', 'A', 'B', 'C', 'D', 'E', 'F'})
+        {
+            flags[c] |= HexFlag;
+        }
+        for (auto c : {'"', '\\', '/', 'b', 'f', 'n', 'r', 't', 'u'})
+        {
+            flags[c] |= EscapeFlag;
+        }
+        return flags;
+    }
+
+    inline constexpr auto number_classes = make_number_classes();
+    inline constexpr auto number_transitions = make_number_transitions();
+    inline constexpr auto char_flags = make_char_flags();
+
+    /**
+     * @return the state after reading c, NumberEnd if c ends the number or NumberInvalid if c makes it
+     * invalid.
+     */
+    constexpr NumberState next_number_state(NumberState state, char c)
+    {
+        return number_transitions[state][number_classes[static_cast<unsigned char>(c)]];
+    }
+
+    /**
+     * @return true for the four whitespace characters of the JSON grammar, independently of the locale.
+     */
+    constexpr bool is_whitespace(char c)
+    {
+        return char_flags[static_cast<unsigned char>(c)] & WhitespaceFlag;
+    }
+
+    constexpr bool is_hex(char c)
+    {
+        return char_flags[static_cast<unsigned char>(c)] & HexFlag;
+    }
+
+    constexpr bool is_escape(char c)
+    {
+        return char_flags[static_cast<unsigned char>(c)] & EscapeFlag;
+    }
+
+    /**
+     * Converts a number that matched the number grammar.
+     */
+    inline double to_double(std::string_view text)
+    {
+        auto out = 0.0;
+        auto res = std::from_chars(text.data(), text.data() + text.size(), out);
+        if (res.ec == std::errc::result_out_of_range)
+        {
+            // from_chars leaves the result alone on overflow and underflow, strtod rounds them to
+            // infinity or zero like the parser always did.
+            return std::strtod(std::string(text).c_str(), NULL);
+        }
+        return out;
+    }
+
+    static_assert(next_number_state(NumberStart, '-') == NumberSign);
+    static_assert(next_number_state(NumberZero, '1') == NumberEnd);
+    static_assert(next_number_state(NumberDot, ',') == NumberInvalid);
+    static_assert(is_whitespace('\n') && !is_whitespace('\v'));
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <string>
 #include <optional>
@@ -73,6 +75,17 @@ namespace jsonpp::pda
     template <typename TState>
     using FinalizeFn = std::function<FinalizeOp(TState &)>;
 
+    /**
+     * Work counters filled in by an instrumented PushdownAutomata.
+     */
+    struct Counters
+    {
+        std::size_t transitions = 0;
+        std::size_t pushes = 0;
+        std::size_t pops = 0;
+        std::size_t max_depth = 0;
+    };
+
     template <typename TState, typename TInput>
     class PushdownAutomata
     {
@@ -80,6 +93,17 @@ namespace jsonpp::pda
         PushdownAutomata(TState initial) : stack(1, initial) {}
         PushdownAutomata() = delete;
 
+#ifdef JSONPP_INSTRUMENTATION
+        void instrument(Counters *counters)
+        {
+            this->counters = counters;
+            if (this->counters)
+            {
+                this->counters->max_depth = std::max(this->counters->max_depth, this->stack.size());
+            }
+        }
+#endif
+
         TransitionResult<TState> transition(
             TInput input,
             TransitionFn<TState, TInput> handle_transition,
@@ -90,6 +114,9 @@ namespace jsonpp::pda
 
     private:
         std::vector<TState> stack;
+#ifdef JSONPP_INSTRUMENTATION
+        Counters *counters = nullptr;
+#endif
     };
 
     template <typename TState, typename TInput>
@@ -98,6 +125,13 @@ namespace jsonpp::pda
         TransitionFn<TState, TInput> handle_transition,
         OnPopFn<TState> on_pop_impl)
     {
+#ifdef JSONPP_INSTRUMENTATION
+        if (this->counters)
+        {
+            ++this->counters->transitions;
+        }
+#endif
+
         while (1)
         {
             auto op = handle_transition(this->stack.back(), input);
@@ -111,6 +145,13 @@ namespace jsonpp::pda
                     [this](const Push<TState> &op) -> Result
                     {
                         this->stack.push_back(op.state);
+#ifdef JSONPP_INSTRUMENTATION
+                        if (this->counters)
+                        {
+                            ++this->counters->pushes;
+                            this->counters->max_depth = std::max(this->counters->max_depth, this->stack.size());
+                        }
+#endif
                         return op.redo;
                     },
                     [this, on_pop_impl](const Pop &op) -> Result
@@ -120,8 +161,14 @@ namespace jsonpp::pda
                             return PoppedEmptyError{};
                         }
 
-                        auto popped = this->stack.back();
+                        auto popped = std::move(this->stack.back());
                         this->stack.pop_back();
+#ifdef JSONPP_INSTRUMENTATION
+                        if (this->counters)
+                        {
+                            ++this->counters->pops;
+                        }
+#endif
 
                         if (auto rejection = on_pop_impl(this->stack.back(), popped))
                         {
@@ -174,7 +221,7 @@ namespace jsonpp::pda
 
             if (auto accept = std::get_if<Accept>(&res))
             {
-                return this->stack.back();
+                return std::move(this->stack.back());
             }
             else if (auto reject = std::get_if<Reject>(&res))
             {
@@ -182,8 +229,14 @@ namespace jsonpp::pda
             }
             else if (auto pop_or_accept = std::get_if<PopOrAccept>(&res))
             {
-                auto popped = this->stack.back();
+                auto popped = std::move(this->stack.back());
                 this->stack.pop_back();
+#ifdef JSONPP_INSTRUMENTATION
+                if (this->counters)
+                {
+                    ++this->counters->pops;
+                }
+#endif
                 if (auto rejection = on_pop_impl(this->stack.back(), popped))
                 {
                     return RejectedError{rejection.value().reason};
@@ -198,13 +251,13 @@ namespace jsonpp::pda
         auto res = handle_finalize(this->stack.back());
         if (auto accept = std::get_if<Accept>(&res))
         {
-            return this->stack.back();
+            return std::move(this->stack.back());
         }
         else if (auto reject = std::get_if<Reject>(&res))
         {
             return RejectedError{reject->reason};
         }
 
-        return this->stack.back();
+        return std::move(this->stack.back());
     }
 }
\ No newline at end of file
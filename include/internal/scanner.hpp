@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace jsonpp::scan
+{
+
+    enum TokenType
+    {
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        Key,
+        String,
+        Number,
+        Literal,
+        End,
+    };
+
+    /**
+     * A single lexical element of a JSON document.
+     *
+     * For Key and String tokens text is the raw string body between the quotes (escapes are
+     * left as written, matching how JsonValue stores strings). offset is the position of the
+     * first byte of the token in the input, including the opening quote or bracket.
+     */
+    struct Token
+    {
+        TokenType type;
+        std::string_view text;
+        std::size_t offset;
+    };
+
+    /**
+     * Pull tokenizer over raw JSON text that never materializes values.
+     *
+     * Structure (commas, colons, nesting) is tracked with an explicit stack of open containers, and
+     * scalars are validated with the same grammar as the parser states. Containers that the caller is
+     * not interested in can be skipped by bracket matching, which only tracks string boundaries and
+     * the kinds of the open brackets, so skipped subtrees are not fully validated.
+     *
+     * Malformed input is reported by throwing std::runtime_error, like JsonValue::parse.
+     */
+    class Tokenizer
+    {
+    public:
+        explicit Tokenizer(std::string_view input) : m_input(input) {}
+        Tokenizer() = delete;
+
+        /**
+         * Reads the next token. Returns a token of type End once the top-level value is complete.
+         */
+        Token next();
+
+        /**
+         * Skips the rest of the innermost open container, including its closing bracket.
+         *
+         * Call this right after next() returned BeginObject or BeginArray to skip that container
+         * without producing tokens for its contents.
+         */
+        void skip();
+
+        /**
+         * Reads the next value and skips over it.
+         *
+         * @return the raw text of the skipped value. Must not be called where a key or closing
+         * bracket is expected.
+         */
+        std::string_view skip_value();
+
+        /**
+         * @return the raw text of the value that starts with token, which must be the token most
+         * recently returned by next(). Containers are skipped to find their end.
+         */
+        std::string_view span(const Token &token);
+
+        std::size_t depth() const { return this->m_stack.size(); }
+        std::size_t position() const { return this->m_pos; }
+        std::string_view input() const { return this->m_input; }
+
+    private:
+        enum Expect
+        {
+            ExpectValueOrEnd,
+            ExpectValue,
+            ExpectCommaOrEnd,
+            ExpectKeyOrEnd,
+            ExpectKey,
+            ExpectColon,
+        };
+
+        struct Frame
+        {
+            bool object;
+            Expect expect;
+        };
+
+        Token read_value();
+        Token read_string(TokenType type);
+        Token read_number();
+        Token read_literal();
+        Token close(TokenType type);
+        void skip_whitespace();
+        void skip_string();
+
+        std::string_view m_input;
+        std::size_t m_pos = 0;
+        std::vector<Frame> m_stack;
+        bool m_done = false;
+    };
+
+}
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include "../lib.hpp"
 #include "pda.hpp"
+#include "lexer.hpp"
 
 namespace jsonpp
 {
@@ -26,6 +30,7 @@ namespace jsonpp
     struct StateString;
     struct StateArray;
     struct StateObject;
+    struct StateRaw;
 
     using State = std::variant<StateValue,
                                StateNumber,
@@ -34,28 +39,20 @@ namespace jsonpp
                                StateExact<Null>,
                                StateString,
                                StateArray,
-                               StateObject>;
+                               StateObject,
+                               StateRaw>;
 
     using StateFinalizationResult = std::variant<JsonValue, std::string>;
 
     struct StateValue
     {
         pda::StateOp<State> transition(const char c);
-        StateFinalizationResult finalize() const;
+        StateFinalizationResult finalize() const &;
+        StateFinalizationResult finalize() &&;
 
         std::optional<JsonValue> m_value;
-    };
-
-    enum StateNumberState
-    {
-        NoDigits,
-        Zero,
-        SomeDigits,
-        Dot,
-        DotDigits,
-        Exp,
-        ExpSign,
-        ExpDigits,
+        // Read the value with a StateRaw, see ParseOptions::raw_pointers.
+        bool raw = false;
     };
 
     struct StateNumber
@@ -64,7 +61,7 @@ namespace jsonpp
         pda::StateOp<State> transition(const char c);
         StateFinalizationResult finalize() const;
 
-        StateNumberState state;
+        lex::NumberState state;
         std::string s;
     };
 
@@ -86,39 +83,63 @@ namespace jsonpp
             return "";
         }
 
+        static constexpr std::size_t length()
+        {
+            return std::char_traits<char>::length(match());
+        }
+
         static constexpr std::optional<StateExact<ExactType>> create_if_valid_start(char c);
         pda::StateOp<State> transition(const char c);
         StateFinalizationResult finalize() const;
 
-        int matched;
+        std::size_t matched;
     };
 
     struct StateString
     {
         static std::optional<StateString> create_if_valid_start(char c);
         pda::StateOp<State> transition(const char c);
-        StateFinalizationResult finalize() const;
+        StateFinalizationResult finalize() const &;
+        StateFinalizationResult finalize() &&;
 
         std::string s;
-        bool finished;
+        bool finished = false;
+        // Inside an escape sequence, right after the backslash.
+        bool escaped = false;
+        // Hex digits still expected by a \u escape.
+        std::uint8_t hex_digits = 0;
     };
 
     struct StateArray
     {
         static std::optional<StateArray> create_if_valid_start(char c);
         pda::StateOp<State> transition(const char c);
-        StateFinalizationResult finalize() const;
+        StateFinalizationResult finalize() const &;
+        StateFinalizationResult finalize() &&;
 
         bool need_comma;
         JsonArray values;
         bool finished;
+
+        // Set for ParseOptions::pack_number_arrays, cleared once an element that is not a number
+        // shows up. While set, numbers are read here rather than in a StateNumber of their own.
+        bool pack = false;
+        JsonNumberArray numbers;
+        // Progress through the number being read, NumberStart between numbers.
+        lex::NumberState number_state = lex::NumberStart;
+        std::string digits;
+
+    private:
+        void end_number();
+        void unpack();
     };
 
     struct StateObject
     {
         static std::optional<StateObject> create_if_valid_start(char c);
         pda::StateOp<State> transition(const char c);
-        StateFinalizationResult finalize() const;
+        StateFinalizationResult finalize() const &;
+        StateFinalizationResult finalize() &&;
 
         std::optional<std::string> current_key;
         bool need_comma;
@@ -126,4 +147,55 @@ namespace jsonpp
         bool finished;
     };
 
-}
\ No newline at end of file
+    /**
+     * Validates a whole value and keeps its text instead of building it.
+     *
+     * Containers are tracked with a string of their closing brackets rather than with states of their
+     * own, so nothing but the text is allocated however the value is nested.
+     */
+    struct StateRaw
+    {
+        enum Expect
+        {
+            ExpectValue,
+            ExpectValueOrEnd,
+            ExpectCommaOrEnd,
+            ExpectKey,
+            ExpectKeyOrEnd,
+            ExpectColon,
+        };
+
+        enum Scalar
+        {
+            NoScalar,
+            KeyScalar,
+            StringScalar,
+            NumberScalar,
+            LiteralScalar,
+        };
+
+        pda::StateOp<State> transition(const char c);
+        StateFinalizationResult finalize() const &;
+        StateFinalizationResult finalize() &&;
+
+        std::string text;
+        // Closing brackets of the open containers, innermost last.
+        std::string closers;
+        // Elements or members started so far in each open container, for ParseOptions::max_elements.
+        std::vector<std::size_t> elements;
+        // Bytes of the string or key being read, for ParseOptions::max_string_length.
+        std::size_t length = 0;
+        Expect expect = ExpectValue;
+        Scalar scalar = NoScalar;
+        bool escaped = false;
+        std::uint8_t hex_digits = 0;
+        lex::NumberState number = lex::NumberStart;
+        std::string_view literal;
+        bool finished = false;
+
+    private:
+        pda::StateOp<State> start_value(const char c);
+        pda::StateOp<State> end_value();
+    };
+
+}
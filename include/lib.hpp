@@ -1,15 +1,29 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <memory>
 #include <variant>
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace jsonpp
 {
 
     class JsonValue;
+    class SourceMap;
+
+    namespace schema
+    {
+        class Schema;
+    }
 
     /**
      * Represents all possible valid JSON objects.
@@ -21,6 +35,21 @@ namespace jsonpp
      */
     using JsonArray = std::vector<JsonValue>;
 
+    /**
+     * A JSON array whose elements are all numbers, stored unboxed. Only produced by parsing with
+     * ParseOptions::pack_number_arrays, and equal to the JsonArray of the same numbers.
+     */
+    using JsonNumberArray = std::vector<double>;
+
+    /**
+     * A value kept as its JSON text, as written in the input, instead of being parsed into a tree.
+     * Only produced by parsing with ParseOptions::raw_pointers or ParseOptions::raw_depth.
+     */
+    struct JsonRaw
+    {
+        std::string text;
+    };
+
     /**
      * Represents all possible valid non-null JSON values.
      */
@@ -29,7 +58,78 @@ namespace jsonpp
         JsonArray,
         std::string,
         double,
-        bool>;
+        bool,
+        JsonNumberArray,
+        JsonRaw>;
+
+    /**
+     * Counters describing the work done to parse one document.
+     *
+     * The parser only fills these in when the library is built with JSONPP_INSTRUMENTATION defined,
+     * otherwise every counter stays zero and instrumentation costs nothing.
+     */
+    struct ParseStats
+    {
+        // Input bytes fed to the pushdown automaton.
+        std::size_t transitions = 0;
+        std::size_t pushes = 0;
+        std::size_t pops = 0;
+        std::size_t max_depth = 0;
+
+        // Heap bytes allocated for the scratch buffers of strings (including keys) and numbers.
+        std::size_t string_bytes = 0;
+        std::size_t number_bytes = 0;
+
+        // Time spent handling input in each kind of state, including absorbing popped children.
+        std::chrono::nanoseconds value_time{0};
+        std::chrono::nanoseconds number_time{0};
+        std::chrono::nanoseconds literal_time{0};
+        std::chrono::nanoseconds string_time{0};
+        std::chrono::nanoseconds array_time{0};
+        std::chrono::nanoseconds object_time{0};
+    };
+
+    /**
+     * Limits applied while parsing untrusted input, and options changing how values are stored.
+     * Parsing throws std::runtime_error as soon as a limit is exceeded, so the work done on hostile
+     * input is bounded. Every limit defaults to unlimited.
+     */
+    struct ParseOptions
+    {
+        // Maximum nesting depth of arrays and objects.
+        std::size_t max_depth = std::numeric_limits<std::size_t>::max();
+        // Maximum size of the input in bytes.
+        std::size_t max_document_size = std::numeric_limits<std::size_t>::max();
+        // Maximum length of a string or key in bytes, as written in the input.
+        std::size_t max_string_length = std::numeric_limits<std::size_t>::max();
+        // Maximum number of elements in one array or members in one object.
+        std::size_t max_elements = std::numeric_limits<std::size_t>::max();
+        // Budget for the memory held by the parsed document, estimated as the bytes of every string
+        // plus the size of every value node and object member.
+        std::size_t max_allocation = std::numeric_limits<std::size_t>::max();
+
+        // Store non-empty arrays whose elements are all numbers as a JsonNumberArray, decoding each
+        // number straight into it instead of into a JsonValue of its own. Elements of such arrays
+        // are not JsonValues, so JsonPointer and JsonPath evaluation treat the array as a leaf.
+        // JSON Patch reaches the elements, boxing the array into a JsonArray when it changes one,
+        // and diff compares it element by element. Its allocation is charged once it is complete.
+        bool pack_number_arrays = false;
+
+        // Keep the values at these JSON Pointers as JsonRaw text, e.g. "/data" or "/items/0". Member
+        // names are compared with object keys as written in the document, escapes included.
+        std::vector<std::string> raw_pointers;
+        // Keep every value nested at least this deep as JsonRaw text, where the members of the root
+        // are at depth 1.
+        //
+        // Raw values are validated like any other value but build no tree, and json() writes their
+        // text back out verbatim. Like packed arrays they are leaves for pointers, paths and patches,
+        // and hashing or comparing one parses its text first.
+        std::size_t raw_depth = std::numeric_limits<std::size_t>::max();
+
+        // Validate the document against this schema while parsing it, rejecting it at the byte
+        // where the first violation completes. See schema::Validator. Must outlive the parse.
+        const schema::Schema *schema = nullptr;
+    };
 
     struct ToJsonVisitor
     {
@@ -38,25 +138,37 @@ namespace jsonpp
         std::string operator()(const std::string &s) const;
         std::string operator()(const double &d) const;
         std::string operator()(const bool &b) const;
+        std::string operator()(const JsonNumberArray &a) const;
+        std::string operator()(const JsonRaw &r) const;
     };
 
     /**
      * Represents all possible valid JSON values.
+     *
+     * Values are immutable, reference-counted nodes, so copying a JsonValue is O(1) and copies share
+     * structure. Reference counts are atomic, which makes it safe for threads to copy and read
+     * shared documents concurrently. See mutable_value for how changes are made.
      */
     class JsonValue
     {
     public:
-        JsonValue(const JsonObject &v) : m_value(v) {}
-        JsonValue(JsonObject &&v) : m_value(std::move(v)) {}
+        JsonValue(const JsonObject &v) : m_value(std::make_shared<Node>(v)) {}
+        JsonValue(JsonObject &&v) : m_value(std::make_shared<Node>(std::move(v))) {}
+
+        JsonValue(const JsonArray &v) : m_value(std::make_shared<Node>(v)) {}
+        JsonValue(JsonArray &&v) : m_value(std::make_shared<Node>(std::move(v))) {}
+
+        JsonValue(const JsonNumberArray &v) : m_value(std::make_shared<Node>(v)) {}
+        JsonValue(JsonNumberArray &&v) : m_value(std::make_shared<Node>(std::move(v))) {}
 
-        JsonValue(const JsonArray &v) : m_value(v) {}
-        JsonValue(JsonArray &&v) : m_value(std::move(v)) {}
+        JsonValue(const JsonRaw &v) : m_value(std::make_shared<Node>(v)) {}
+        JsonValue(JsonRaw &&v) : m_value(std::make_shared<Node>(std::move(v))) {}
 
-        JsonValue(const std::string &v) : m_value(v) {}
-        JsonValue(std::string &&v) : m_value(std::move(v)) {}
+        JsonValue(const std::string &v) : m_value(std::make_shared<Node>(v)) {}
+        JsonValue(std::string &&v) : m_value(std::make_shared<Node>(std::move(v))) {}
 
-        JsonValue(double v) : m_value(v) {}
-        explicit JsonValue(bool v) : m_value(v) {}
+        JsonValue(double v) : m_value(std::make_shared<Node>(v)) {}
+        explicit JsonValue(bool v) : m_value(std::make_shared<Node>(v)) {}
         JsonValue(std::nullptr_t) {}
 
         template <typename T>
@@ -79,21 +191,79 @@ namespace jsonpp
                 return std::nullopt;
             }
 
-            return std::cref(*this->m_value);
+            return std::cref(this->m_value->value);
         }
 
-        std::string json() const
+        /**
+         * Retrieve a mutable reference to the inner value if it exists.
+         *
+         * If the node is shared with other copies it is copied first, so the change is only seen
+         * through this JsonValue. That copy is shallow because children are shared too, so changing
+         * a nested value only copies the nodes on the path to it.
+         *
+         * WARNING: Do not use this reference beyond the lifetime of the JsonValue containing it, or
+         * after copying the JsonValue or hashing it or one of its parents, since the node is then
+         * shared again or its cached hash would go stale.
+         *
+         * @return a mutable reference to the inner value if it exists.
+         */
+        std::optional<std::reference_wrapper<JsonValueVariant>> mutable_value()
         {
-            if (this->m_value)
+            if (!this->m_value)
             {
-                return std::visit(ToJsonVisitor{}, this->m_value.value());
+                return std::nullopt;
+            }
+
+            if (this->m_value.use_count() != 1)
+            {
+                this->m_value = std::make_shared<Node>(*this->m_value);
             }
             else
             {
-                return "null";
+                // Pairs with the release done by other owners when they dropped their references.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                this->m_value->hash.store(0, std::memory_order_relaxed);
             }
+
+            return std::ref(this->m_value->value);
         }
 
+        /**
+         * @return true if both values refer to the same node, which means they are equal without
+         * having to compare their contents.
+         */
+        bool shares(const JsonValue &other) const
+        {
+            return this->m_value == other.m_value;
+        }
+
+        /**
+         * Hashes the value structurally. Object members are combined independently of their order,
+         * -0 hashes like 0, and strings are hashed as stored, escapes included.
+         *
+         * The hash of every node is cached the first time it is computed, so hashing a document
+         * again, or any document sharing subtrees with it, only visits nodes that changed since.
+         *
+         * @return the hash of the value.
+         */
+        std::size_t hash() const;
+
+        /**
+         * Compares two values structurally, with the same rules as hash.
+         *
+         * Shared nodes are equal without being visited, and nodes whose hashes are both cached and
+         * differ are known to be different without being visited.
+         *
+         * @return true if both values are equal.
+         */
+        bool equals(const JsonValue &other) const;
+
+        /**
+         * @return the JSON text of the value. Containers are written with serialize::Serializer,
+         * which does not recurse, so any nesting depth can be written.
+         */
+        std::string json() const;
+
         /**
          * Creates a JsonValue from a string containing valid JSON.
          *
@@ -102,8 +272,174 @@ namespace jsonpp
          */
         static JsonValue parse(const std::string_view json_str);
 
+        /**
+         * Creates a JsonValue from a string containing valid JSON and reports the work it took.
+         *
+         * @param json_str std::string containing valid JSON.
+         * @param stats reset and then filled in while parsing, even if parsing fails. See ParseStats.
+         * @return JsonValue containing that parsed JSON from json_str.
+         */
+        static JsonValue parse(const std::string_view json_str, ParseStats &stats);
+
+        /**
+         * Creates a JsonValue from a string containing valid JSON within the given limits.
+         *
+         * @param json_str std::string containing valid JSON.
+         * @param options limits to enforce while parsing. See ParseOptions.
+         * @return JsonValue containing that parsed JSON from json_str.
+         */
+        static JsonValue parse(const std::string_view json_str, const ParseOptions &options);
+        static JsonValue parse(const std::string_view json_str, const ParseOptions &options, ParseStats &stats);
+
+        /**
+         * Creates a JsonValue from a string containing valid JSON and records where every value
+         * came from.
+         *
+         * @param source_map cleared and then filled in while parsing. See SourceMap.
+         */
+        static JsonValue parse(const std::string_view json_str, const ParseOptions &options, SourceMap &source_map);
+
+    private:
+        friend class SourceMap;
+
+        struct Node
+        {
+            // Builds the alternative in place. Going through a temporary JsonValueVariant made GCC 12
+            // report a bogus -Wfree-nonheap-object when it was a moved-from JsonObject.
+            template <typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Node>>>
+            explicit Node(T &&v) : value(std::forward<T>(v)) {}
+            Node(const Node &other) : value(other.value) {}
+            ~Node()
+            {
+                if (std::holds_alternative<JsonObject>(this->value) || std::holds_alternative<JsonArray>(this->value))
+                {
+                    this->free_children();
+                }
+            }
+
+            // Frees deep trees with an explicit stack rather than unbounded recursion.
+            void free_children();
+
+            JsonValueVariant value;
+            // Cached result of hash(), 0 until it is computed.
+            mutable std::atomic<std::size_t> hash{0};
+        };
+
+        // Empty for null.
+        std::shared_ptr<Node> m_value;
+    };
+
+    /**
+     * Byte offsets of a value in the text it was parsed from, end exclusive.
+     */
+    struct SourceSpan
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    /**
+     * Side table from the values of a parsed document to their spans in the input, filled in by
+     * parsing with a SourceMap.
+     *
+     * Values are identified by their node, so lookups only make sense while the parsed document is
+     * alive and unmodified. Nulls have no node and are not recorded, neither are the elements of a
+     * JsonNumberArray.
+     */
+    class SourceMap
+    {
+    public:
+        /**
+         * @return the span of a value of the parsed document, or of a copy of one.
+         */
+        std::optional<SourceSpan> find(const JsonValue &value) const
+        {
+            auto it = this->m_spans.find(value.m_value.get());
+            if (it == this->m_spans.end())
+            {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        /**
+         * @param json_str the text the document was parsed from.
+         * @return the raw text of a value, for forwarding it without serializing it again.
+         */
+        std::optional<std::string_view> slice(std::string_view json_str, const JsonValue &value) const
+        {
+            auto span = this->find(value);
+            if (!span)
+            {
+                return std::nullopt;
+            }
+            return json_str.substr(span->begin, span->end - span->begin);
+        }
+
+        std::size_t size() const { return this->m_spans.size(); }
+
+    private:
+        friend class Parser;
+
+        void record(const JsonValue &value, SourceSpan span)
+        {
+            if (value.m_value)
+            {
+                this->m_spans.emplace(value.m_value.get(), span);
+            }
+        }
+
+        void clear() { this->m_spans.clear(); }
+
+        std::unordered_map<const void *, SourceSpan> m_spans;
+    };
+
+    /**
+     * Parses a document that arrives in chunks.
+     *
+     * All progress lives on the parser's explicit stack, so chunks may be split anywhere, even inside
+     * a string or number, and nothing is buffered besides the partial values themselves.
+     * Feeding a whole document and then finishing is exactly what JsonValue::parse does.
+     */
+    class Parser
+    {
+    public:
+        explicit Parser(const ParseOptions &options = ParseOptions{});
+
+        /**
+         * @param stats reset and then filled in while parsing, complete once finish returns or the
+         * parser is destroyed. See ParseStats.
+         */
+        Parser(const ParseOptions &options, ParseStats &stats);
+
+        /**
+         * @param source_map cleared and then filled in while parsing, complete once finish returns.
+         * See SourceMap.
+         */
+        Parser(const ParseOptions &options, SourceMap &source_map);
+
+        Parser(Parser &&) noexcept;
+        Parser &operator=(Parser &&) noexcept;
+        ~Parser();
+
+        /**
+         * Parses the next chunk of the document.
+         *
+         * Throws std::runtime_error as soon as the input so far cannot be the start of valid JSON or
+         * breaks a limit in ParseOptions. The parser must not be used after that.
+         */
+        void feed(const std::string_view chunk);
+
+        /**
+         * Ends the input. Must be called exactly once.
+         *
+         * @return the parsed document. Throws std::runtime_error if the document is incomplete.
+         */
+        JsonValue finish();
+
     private:
-        std::optional<JsonValueVariant> m_value;
+        struct Impl;
+        std::unique_ptr<Impl> m_impl;
     };
 
 }
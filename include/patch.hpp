@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "lib.hpp"
+
+namespace jsonpp::patch
+{
+
+    /**
+     * Applies an RFC 6902 JSON Patch to a document.
+     *
+     * The patch is an array of operation objects ("add", "remove", "replace", "move", "copy" and
+     * "test"). Paths are JSON Pointers whose member names are compared with object keys as written
+     * in the document, escapes included. "move" relinks the subtree instead of copying it, and
+     * "add", "replace" and "copy" share the inserted value with the patch, so no operation is
+     * proportional to the size of the values involved.
+     *
+     * The patch is applied atomically: if any operation fails the document is left unchanged. Only
+     * the nodes on the patched paths are copied, and only if they are shared with other copies.
+     *
+     * @param document the document to patch in place.
+     * @param patch the JSON Patch document.
+     * Throws std::runtime_error if the patch is malformed, a path does not exist, or a "test"
+     * operation fails.
+     */
+    void apply(JsonValue &document, const JsonValue &patch);
+
+    /**
+     * Applies an RFC 7396 JSON Merge Patch to a document.
+     *
+     * Object members in the patch are merged recursively, null members remove the matching member
+     * from the document, and any other patch value replaces the target outright.
+     *
+     * @param document the document to patch in place.
+     * @param patch the merge patch.
+     */
+    void merge(JsonValue &document, const JsonValue &patch);
+
+    /**
+     * Computes an RFC 6902 JSON Patch that turns one document into another, so that applying
+     * diff(from, to) to from yields a document equal to to.
+     *
+     * Subtrees shared by both documents are skipped without being visited, and subtrees whose
+     * hashes differ are known to have changed without comparing them. Hashes are cached on both
+     * documents (see JsonValue::hash), so diffing against the same snapshot again only hashes what
+     * changed. Object members are added, removed or diffed recursively, array elements are diffed by
+     * position with trailing elements added or removed, and anything else that differs is replaced.
+     * A packed JsonNumberArray is diffed like the JsonArray it equals.
+     *
+     * @return the JSON Patch document, an empty array if both documents are equal.
+     */
+    JsonValue diff(const JsonValue &from, const JsonValue &to);
+
+    /**
+     * Applies an RFC 6902 JSON Patch to raw JSON text.
+     *
+     * When the patch only holds "replace" and "test" operations on paths that do not contain one
+     * another, the targets are located in a single scan and the serialized replacements are spliced
+     * into the text, so the rest of the document is neither parsed nor reformatted. Like
+     * JsonPointer::extract, the parts of the document that are skipped are not fully validated.
+     * Any other patch falls back to parsing json_str, applying the patch and serializing the result.
+     *
+     * @return the patched JSON text. Throws std::runtime_error like apply.
+     */
+    std::string splice(std::string_view json_str, const JsonValue &patch);
+
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp
+{
+
+    /**
+     * A JSON Pointer reference token. Matches an object member with the same name, or an array
+     * element when the token is an array index ("0", "17", ...).
+     */
+    struct PathToken
+    {
+        std::string token;
+    };
+
+    /**
+     * Matches an object member by name.
+     */
+    struct PathMember
+    {
+        std::string name;
+    };
+
+    /**
+     * Matches an array element by position.
+     */
+    struct PathIndex
+    {
+        std::size_t index;
+    };
+
+    /**
+     * Matches every member of an object or element of an array.
+     */
+    struct PathWildcard
+    {
+    };
+
+    using PathSegment = std::variant<PathToken, PathMember, PathIndex, PathWildcard>;
+
+    /**
+     * RFC 6901 JSON Pointer, e.g. "/meta/trace_id" or "/items/0".
+     *
+     * Member names are compared with object keys as written in the document, escapes included.
+     */
+    class JsonPointer
+    {
+    public:
+        /**
+         * Parses a JSON Pointer.
+         *
+         * @param pointer the pointer text. The empty string refers to the whole document.
+         * @return the parsed pointer. Throws std::runtime_error if the pointer is malformed.
+         */
+        static JsonPointer parse(std::string_view pointer);
+
+        /**
+         * Resolves the pointer against a parsed document.
+         *
+         * WARNING: Do not use the returned reference beyond the lifetime of root.
+         *
+         * @return a reference to the referenced value if it exists.
+         */
+        std::optional<std::reference_wrapper<const JsonValue>> evaluate(const JsonValue &root) const;
+
+        /**
+         * Resolves the pointer directly against raw JSON text.
+         *
+         * Only the referenced value is parsed. Subtrees that are not on the path are skipped by
+         * bracket matching and the scan stops as soon as the value is found, so the rest of the
+         * document is not validated.
+         *
+         * @return the referenced value if it exists.
+         */
+        std::optional<JsonValue> extract(std::string_view json_str) const;
+
+        const std::vector<PathSegment> &segments() const { return this->m_segments; }
+
+        /**
+         * Interprets a reference token as an array index.
+         *
+         * @return the index if token is "0" or a decimal number without leading zeros.
+         */
+        static std::optional<std::size_t> array_index(std::string_view token);
+
+    private:
+        explicit JsonPointer(std::vector<PathSegment> segments) : m_segments(std::move(segments)) {}
+
+        std::vector<PathSegment> m_segments;
+    };
+
+    /**
+     * A subset of JSONPath: the root "$" followed by any number of ".name", "['name']", "[3]",
+     * ".*" and "[*]" segments. Recursive descent and filters are not supported.
+     */
+    class JsonPath
+    {
+    public:
+        /**
+         * Parses a JSONPath expression.
+         *
+         * @return the parsed path. Throws std::runtime_error if the path is malformed or uses
+         * unsupported syntax.
+         */
+        static JsonPath parse(std::string_view path);
+
+        /**
+         * Collects every value matched by the path in a parsed document. Object members are
+         * visited in JsonObject iteration order.
+         *
+         * WARNING: Do not use the returned references beyond the lifetime of root.
+         */
+        std::vector<std::reference_wrapper<const JsonValue>> evaluate(const JsonValue &root) const;
+
+        /**
+         * Collects every value matched by the path directly from raw JSON text, in document order.
+         *
+         * Only matched values are parsed, everything else is skipped by bracket matching.
+         */
+        std::vector<JsonValue> extract(std::string_view json_str) const;
+
+        const std::vector<PathSegment> &segments() const { return this->m_segments; }
+
+    private:
+        explicit JsonPath(std::vector<PathSegment> segments) : m_segments(std::move(segments)) {}
+
+        std::vector<PathSegment> m_segments;
+    };
+
+    /**
+     * A fixed set of JSON Pointers compiled into a trie so that all of them can be extracted from
+     * raw JSON text in a single scan.
+     *
+     * Only containers on the way to a requested path are tokenized; every other subtree is skipped by
+     * bracket matching, and scanning stops as soon as every pointer has either been found or can no
+     * longer match. Values are parsed only for the paths that were requested.
+     */
+    class PathMatcher
+    {
+    public:
+        /**
+         * Compiles pointers into a matcher. Results are reported in the same order as pointers.
+         */
+        static PathMatcher compile(const std::vector<JsonPointer> &pointers);
+
+        /**
+         * Extracts every compiled pointer from raw JSON text.
+         *
+         * @return one entry per compiled pointer, holding the referenced value if it exists. If a
+         * member appears more than once the first occurrence wins, like in JsonValue::parse.
+         */
+        std::vector<std::optional<JsonValue>> extract(std::string_view json_str) const;
+
+        /**
+         * Finds the raw text of every compiled pointer without parsing any value.
+         *
+         * @return one entry per compiled pointer, holding a view into json_str that spans the
+         * referenced value if it exists.
+         */
+        std::vector<std::optional<std::string_view>> locate(std::string_view json_str) const;
+
+        std::size_t size() const { return this->m_size; }
+
+    private:
+        struct Node
+        {
+            // Children reached through an object member, sorted by name.
+            std::vector<std::pair<std::string, std::size_t>> members;
+            // Children reached through an array index, sorted by index.
+            std::vector<std::pair<std::size_t, std::size_t>> indices;
+            // Pointers that end at this node.
+            std::vector<std::size_t> queries;
+            // Number of pointers that end at this node or below it.
+            std::size_t query_count = 0;
+        };
+
+        PathMatcher() = default;
+
+        std::optional<std::size_t> find_member(std::size_t node, std::string_view name) const;
+        std::optional<std::size_t> find_index(std::size_t node, std::size_t index) const;
+        void resolve(std::size_t node, const JsonValue &value, std::vector<std::optional<JsonValue>> &results) const;
+
+        /**
+         * Scans json_str along the compiled paths and calls resolve(node, text) with the raw text of
+         * every value that pointers end at. A container with pointers below it is scanned rather
+         * than skipped, and resolved once it closes. Defined in query.cpp, where it is used.
+         */
+        template <typename Resolve>
+        void walk(std::string_view json_str, Resolve &&resolve) const;
+
+        std::vector<Node> m_nodes;
+        std::size_t m_size = 0;
+    };
+
+}
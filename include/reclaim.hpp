@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::reclaim
+{
+
+    /**
+     * Frees documents on a background thread, so that dropping a large tree does not stall the
+     * thread that was using it.
+     *
+     * Handing over a value only moves one pointer under a mutex. The worker picks up everything
+     * handed over since its last round in one batch and frees it outside of the lock. Like any other
+     * release, freeing a document that other JsonValues still share only drops this reference.
+     */
+    class Reclaimer
+    {
+    public:
+        Reclaimer();
+
+        /**
+         * Frees every document that is still queued, then stops the worker.
+         */
+        ~Reclaimer();
+
+        Reclaimer(const Reclaimer &) = delete;
+        Reclaimer &operator=(const Reclaimer &) = delete;
+
+        /**
+         * Hands a document over to be freed on the worker. Scalars and empty containers are freed
+         * right away, since there is nothing to gain from moving them.
+         */
+        void dispose(JsonValue value);
+
+        /**
+         * Blocks until every document handed over so far has been freed.
+         */
+        void flush();
+
+    private:
+        void run();
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_idle;
+        std::vector<JsonValue> m_queue;
+        bool m_busy = false;
+        bool m_stop = false;
+        // Started last, once everything it uses is initialized.
+        std::thread m_thread;
+    };
+
+}
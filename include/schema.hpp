@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::schema
+{
+
+    /**
+     * A JSON Schema compiled into a table of nodes, one per subschema.
+     *
+     * Supported keywords are type (including "integer" and arrays of types), properties, required,
+     * items (a single schema), enum (scalar values only), minimum, maximum and maxLength. Boolean
+     * schemas are supported too. Annotations like title and description are ignored, and any other
+     * keyword is rejected when compiling rather than silently not enforced.
+     *
+     * Property names and string enum values are compared with object keys and strings as written in
+     * the document, escapes included.
+     */
+    class Schema
+    {
+    public:
+        /**
+         * Compiles a schema.
+         *
+         * @return the compiled schema. Throws std::runtime_error if the schema is malformed or uses
+         * an unsupported keyword.
+         */
+        static Schema compile(const JsonValue &schema);
+
+        /**
+         * Validates raw JSON text in a single pass without building a tree. Named apart from
+         * validate because JsonValue converts from std::string.
+         *
+         * Throws std::runtime_error at the first violation, or if the text is not valid JSON.
+         */
+        void scan(std::string_view json_str) const;
+
+        /**
+         * Validates a parsed document. Throws std::runtime_error at the first violation.
+         */
+        void validate(const JsonValue &value) const;
+
+    private:
+        friend class Validator;
+
+        enum Type : unsigned
+        {
+            NullType = 1,
+            BooleanType = 2,
+            ObjectType = 4,
+            ArrayType = 8,
+            NumberType = 16,
+            StringType = 32,
+            IntegerType = 64,
+            AnyType = 127,
+        };
+
+        struct Member
+        {
+            std::string name;
+            std::size_t node;
+            bool required;
+        };
+
+        struct Node
+        {
+            unsigned types = AnyType;
+            // Sorted by name.
+            std::vector<Member> members;
+            std::size_t required = 0;
+            std::size_t items = 0;
+            std::optional<double> minimum;
+            std::optional<double> maximum;
+            std::optional<std::size_t> max_length;
+
+            bool has_enum = false;
+            unsigned enum_literals = 0;
+            std::vector<double> enum_numbers;
+            std::vector<std::string> enum_strings;
+        };
+
+        Schema() = default;
+
+        std::size_t add(const JsonValue &schema);
+
+        // Node 0 accepts everything, and is used for values the schema says nothing about.
+        std::vector<Node> m_nodes;
+        std::size_t m_root = 0;
+    };
+
+    /**
+     * Checks one document against a Schema from a stream of parse events, without building a tree.
+     *
+     * Events are fed in document order: begin and end of every container, every object key before
+     * its value, and every scalar. Each event throws std::runtime_error if it completes a violation,
+     * so input is rejected as soon as it can no longer match. Besides Schema::validate, the events
+     * are fed by the parser when ParseOptions::schema is set.
+     *
+     * WARNING: Do not use a Validator beyond the lifetime of its Schema.
+     */
+    class Validator
+    {
+    public:
+        explicit Validator(const Schema &schema) : m_schema(schema) {}
+
+        void begin_object();
+        void key(std::string_view key);
+        void end_object();
+        void begin_array();
+        void end_array();
+        void string(std::string_view raw);
+        void number(double d);
+        void boolean(bool b);
+        void null();
+
+        /**
+         * Feeds the events of a whole parsed value.
+         */
+        void value(const JsonValue &value);
+
+        /**
+         * Feeds the events of a whole value from raw JSON text. Named apart from value because
+         * JsonValue converts from std::string.
+         */
+        void scan(std::string_view json_str);
+
+    private:
+        struct Frame
+        {
+            std::size_t node;
+            bool object;
+            // Start of the seen flags for the members of node.
+            std::size_t seen;
+            std::size_t required_seen;
+            // Node of the value of the current member.
+            std::size_t next;
+        };
+
+        /**
+         * @return the node of the value that starts now, after checking that it allows type.
+         */
+        std::size_t start_value(unsigned type);
+
+        const Schema &m_schema;
+        std::vector<Frame> m_stack;
+        std::vector<std::uint8_t> m_seen;
+    };
+
+}
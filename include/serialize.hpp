@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp::serialize
+{
+
+    constexpr std::size_t DefaultBufferSize = 64 * 1024;
+
+    /**
+     * Writes the same text as JsonValue::json to a sink through a fixed-size buffer.
+     *
+     * Containers are walked with an explicit stack instead of recursion, so memory use is
+     * proportional to the nesting depth plus the buffer size no matter how large the document is.
+     * The buffer is handed to the sink whenever it fills up, and once more at the end.
+     *
+     * The sink returns how many bytes of the chunk it took. Taking fewer signals backpressure: write
+     * returns false, keeps the rest of the chunk, and offers it again when write is called next, for
+     * example once a non-blocking socket is writable again.
+     *
+     * WARNING: Do not use a Serializer beyond the lifetime of the value it writes, or change the
+     * value while it is being written.
+     */
+    class Serializer
+    {
+    public:
+        using Sink = std::function<std::size_t(std::string_view)>;
+
+        /**
+         * @param sink called with consecutive chunks of the output. A chunk is only valid during the
+         * call.
+         * @param buffer_size the size of the buffer, and so the largest chunk. Must not be 0.
+         */
+        Serializer(const JsonValue &value, Sink sink, std::size_t buffer_size = DefaultBufferSize);
+        Serializer() = delete;
+
+        // Pending output may point into the serializer itself.
+        Serializer(const Serializer &) = delete;
+        Serializer &operator=(const Serializer &) = delete;
+
+        /**
+         * Writes output until it is complete or the sink pushes back.
+         *
+         * @return true once the sink has taken all of the output.
+         */
+        bool write();
+
+        bool done() const { return this->m_finished && this->m_offset == this->m_buffer.size(); }
+
+    private:
+        struct ObjectFrame
+        {
+            JsonObject::const_iterator it;
+            JsonObject::const_iterator end;
+            bool first;
+        };
+
+        struct ArrayFrame
+        {
+            const JsonArray *elements;
+            std::size_t index;
+        };
+
+        struct NumbersFrame
+        {
+            const JsonNumberArray *numbers;
+            std::size_t index;
+        };
+
+        using Frame = std::variant<ObjectFrame, ArrayFrame, NumbersFrame>;
+
+        /**
+         * Queues the pieces of the next token: a scalar, a bracket, or a member key with the start
+         * of its value.
+         */
+        void next_token();
+        void start_value(const JsonValue &value);
+        void number(double d);
+        bool drain();
+
+        const JsonValue &m_value;
+        Sink m_sink;
+        std::size_t m_capacity;
+        std::string m_buffer;
+        // Start of the part of m_buffer the sink has not taken yet.
+        std::size_t m_offset = 0;
+
+        std::vector<Frame> m_stack;
+        // Output that is not in the buffer yet, in order. Views into the value or m_number.
+        std::vector<std::string_view> m_pieces;
+        std::size_t m_piece = 0;
+        std::array<char, 32> m_number;
+        bool m_started = false;
+        bool m_finished = false;
+    };
+
+    /**
+     * Writes value to a stream. Throws std::runtime_error if the stream fails.
+     */
+    void write(const JsonValue &value, std::ostream &out, std::size_t buffer_size = DefaultBufferSize);
+
+    /**
+     * Writes value to a blocking file descriptor. Throws std::runtime_error if a write fails.
+     *
+     * Use a Serializer with a sink that returns how much write(2) took for non-blocking ones.
+     */
+    void write(const JsonValue &value, int fd, std::size_t buffer_size = DefaultBufferSize);
+
+}
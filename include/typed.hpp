@@ -0,0 +1,563 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lib.hpp"
+
+namespace jsonpp
+{
+
+    /**
+     * Describes one member of a user struct for typed parsing and serialization.
+     */
+    template <typename T, typename M>
+    struct Field
+    {
+        using Struct = T;
+        using Member = M;
+
+        std::string_view name;
+        M T::*member;
+    };
+
+    template <typename T, typename M, std::size_t N>
+    constexpr Field<T, M> field(const char (&name)[N], M T::*member)
+    {
+        return Field<T, M>{std::string_view(name, N - 1), member};
+    }
+
+    /**
+     * Specialize this for a struct to make it usable with parse_as and to_json. The specialization must have a
+     * static constexpr tuple of fields named fields, e.g.
+     *
+     *     template <>
+     *     struct jsonpp::JsonFields<User>
+     *     {
+     *         static constexpr auto fields = std::make_tuple(
+     *             jsonpp::field("name", &User::name),
+     *             jsonpp::field("age", &User::age));
+     *     };
+     *
+     * Supported member types are bool, arithmetic types, std::string, std::vector, std::optional,
+     * JsonValue and other structs with a JsonFields specialization. Strings keep their escapes as
+     * written, like JsonValue.
+     */
+    template <typename T>
+    struct JsonFields
+    {
+    };
+
+    namespace typed
+    {
+
+        enum TokenType
+        {
+            BeginObject,
+            EndObject,
+            BeginArray,
+            EndArray,
+            Key,
+            String,
+            Number,
+            Literal,
+            End,
+        };
+
+        /**
+         * A single lexical element of the input. For Key and String tokens text is the string body
+         * between the quotes, escapes left as written. offset is the position of the first byte of the
+         * token in the input.
+         */
+        struct Token
+        {
+            TokenType type;
+            std::string_view text;
+            std::size_t offset;
+        };
+
+        /**
+         * The JSON text the readers pull tokens from. Structure and scalars are validated as they are
+         * read, malformed input throws std::runtime_error.
+         */
+        class Input
+        {
+        public:
+            explicit Input(std::string_view json_str);
+            Input() = delete;
+            Input(const Input &) = delete;
+            Input &operator=(const Input &) = delete;
+            ~Input();
+
+            /**
+             * Reads the next token. Returns a token of type End once the top-level value is complete.
+             */
+            Token next();
+
+            /**
+             * @return the raw text of the value that starts with token, which must be the token most
+             * recently returned by next(). Containers are skipped to find their end.
+             */
+            std::string_view span(const Token &token);
+
+            /**
+             * Skips the value that starts with token, which must be the token most recently returned
+             * by next(). Unlike span, every token of a skipped container is read and validated.
+             */
+            void skip(const Token &token);
+
+        private:
+            struct Impl;
+            std::unique_ptr<Impl> m_impl;
+        };
+
+        template <typename T, typename = void>
+        struct has_fields : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct has_fields<T, std::void_t<decltype(JsonFields<T>::fields)>> : std::true_type
+        {
+        };
+
+        template <typename T, typename = void>
+        struct Reader;
+
+        /**
+         * Values for elements that are about to be read into. JsonValue has no default constructor.
+         */
+        template <typename T>
+        T make_default()
+        {
+            if constexpr (std::is_same_v<T, JsonValue>)
+            {
+                return JsonValue(nullptr);
+            }
+            else
+            {
+                return T{};
+            }
+        }
+
+        template <>
+        struct Reader<bool>
+        {
+            static void read(Input &, const Token &token, bool &out)
+            {
+                if (token.type != Literal || token.text == "null")
+                {
+                    throw std::runtime_error("Expected JSON boolean");
+                }
+                out = token.text == "true";
+            }
+        };
+
+        template <typename T>
+        struct Reader<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+        {
+            static void read(Input &, const Token &token, T &out)
+            {
+                if (token.type != Number)
+                {
+                    throw std::runtime_error("Expected JSON number");
+                }
+                auto end = token.text.data() + token.text.size();
+                auto res = std::from_chars(token.text.data(), end, out);
+                if (res.ec != std::errc() || res.ptr != end)
+                {
+                    throw std::runtime_error(std::is_integral_v<T> ? "JSON number is not a representable integer" : "JSON number is not representable");
+                }
+            }
+        };
+
+        template <>
+        struct Reader<std::string>
+        {
+            static void read(Input &, const Token &token, std::string &out)
+            {
+                if (token.type != String)
+                {
+                    throw std::runtime_error("Expected JSON string");
+                }
+                out.assign(token.text);
+            }
+        };
+
+        template <>
+        struct Reader<JsonValue>
+        {
+            static void read(Input &input, const Token &token, JsonValue &out)
+            {
+                out = JsonValue::parse(input.span(token));
+            }
+        };
+
+        template <typename E>
+        struct Reader<std::optional<E>>
+        {
+            static void read(Input &input, const Token &token, std::optional<E> &out)
+            {
+                if (token.type == Literal && token.text == "null")
+                {
+                    out.reset();
+                    return;
+                }
+                Reader<E>::read(input, token, out.emplace(make_default<E>()));
+            }
+        };
+
+        template <typename E>
+        struct Reader<std::vector<E>>
+        {
+            static void read(Input &input, const Token &token, std::vector<E> &out)
+            {
+                if (token.type != BeginArray)
+                {
+                    throw std::runtime_error("Expected JSON array");
+                }
+                out.clear();
+                while (1)
+                {
+                    auto element = input.next();
+                    if (element.type == EndArray)
+                    {
+                        return;
+                    }
+                    // Read into a local, std::vector<bool> has no element references to read into.
+                    auto value = make_default<E>();
+                    Reader<E>::read(input, element, value);
+                    out.push_back(std::move(value));
+                }
+            }
+        };
+
+        /**
+         * Maps member names to field indices by bucketing them on length at compile time, so a key
+         * is only compared against the names that have the same length.
+         */
+        template <std::size_t N, std::size_t MaxLength>
+        struct KeyTable
+        {
+            std::array<std::string_view, N> names{};
+            std::array<std::size_t, N> order{};
+            std::array<std::size_t, MaxLength + 2> starts{};
+
+            constexpr std::size_t find(std::string_view key) const
+            {
+                if (key.size() > MaxLength)
+                {
+                    return N;
+                }
+                for (auto i = this->starts[key.size()]; i < this->starts[key.size() + 1]; ++i)
+                {
+                    if (this->names[this->order[i]] == key)
+                    {
+                        return this->order[i];
+                    }
+                }
+                return N;
+            }
+        };
+
+        template <typename Fields, std::size_t... I>
+        constexpr std::size_t max_name_length(const Fields &fields, std::index_sequence<I...>)
+        {
+            std::size_t length = 0;
+            ((length = std::get<I>(fields).name.size() > length ? std::get<I>(fields).name.size() : length), ...);
+            return length;
+        }
+
+        template <std::size_t MaxLength, typename Fields, std::size_t... I>
+        constexpr auto make_key_table(const Fields &fields, std::index_sequence<I...>)
+        {
+            auto table = KeyTable<sizeof...(I), MaxLength>{};
+            table.names = {std::get<I>(fields).name...};
+
+            // Counting sort of the field indices by name length.
+            for (auto name : table.names)
+            {
+                ++table.starts[name.size() + 1];
+            }
+            for (std::size_t length = 1; length < table.starts.size(); ++length)
+            {
+                table.starts[length] += table.starts[length - 1];
+            }
+            auto next = table.starts;
+            for (std::size_t i = 0; i < table.names.size(); ++i)
+            {
+                table.order[next[table.names[i].size()]++] = i;
+            }
+
+            return table;
+        }
+
+        template <typename T>
+        struct Reader<T, std::enable_if_t<has_fields<T>::value>>
+        {
+            static constexpr const auto &fields = JsonFields<T>::fields;
+            static constexpr std::size_t size = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+            static constexpr auto keys = make_key_table<max_name_length(fields, std::make_index_sequence<size>{})>(
+                fields, std::make_index_sequence<size>{});
+
+            using ReadFn = void (*)(Input &, const Token &, T &);
+
+            template <std::size_t I>
+            static void read_field(Input &input, const Token &token, T &out)
+            {
+                const auto &f = std::get<I>(fields);
+                Reader<typename std::decay_t<decltype(f)>::Member>::read(input, token, out.*(f.member));
+            }
+
+            template <std::size_t... I>
+            static constexpr std::array<ReadFn, size> make_readers(std::index_sequence<I...>)
+            {
+                return {&read_field<I>...};
+            }
+
+            static constexpr std::array<ReadFn, size> readers = make_readers(std::make_index_sequence<size>{});
+
+            static void read(Input &input, const Token &token, T &out)
+            {
+                if (token.type != BeginObject)
+                {
+                    throw std::runtime_error("Expected JSON object");
+                }
+
+                // As in JsonValue::parse, the first occurrence of a member wins.
+                auto seen = std::array<bool, size>{};
+                while (1)
+                {
+                    auto key = input.next();
+                    if (key.type == EndObject)
+                    {
+                        return;
+                    }
+
+                    auto value = input.next();
+                    auto i = keys.find(key.text);
+                    if (i == size || seen[i])
+                    {
+                        input.skip(value);
+                        continue;
+                    }
+                    seen[i] = true;
+                    readers[i](input, value, out);
+                }
+            }
+        };
+
+        template <typename T, typename = void>
+        struct Writer;
+
+        template <>
+        struct Writer<bool>
+        {
+            static void write(const bool &value, std::string &out)
+            {
+                out.append(value ? "true" : "false");
+            }
+        };
+
+        template <typename T>
+        struct Writer<T, std::enable_if_t<std::is_arithmetic_v<T>>>
+        {
+            static void write(const T &value, std::string &out)
+            {
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    // JSON has no representation for infinities and NaN.
+                    if (!std::isfinite(value))
+                    {
+                        out.append("null");
+                        return;
+                    }
+                }
+
+                char buffer[32];
+                auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                out.append(buffer, res.ptr);
+            }
+        };
+
+        template <>
+        struct Writer<std::string>
+        {
+            static void write(const std::string &value, std::string &out)
+            {
+                out.push_back('"');
+                out.append(value);
+                out.push_back('"');
+            }
+        };
+
+        template <>
+        struct Writer<JsonValue>
+        {
+            static void write(const JsonValue &value, std::string &out)
+            {
+                out.append(value.json());
+            }
+        };
+
+        template <typename E>
+        struct Writer<std::optional<E>>
+        {
+            static void write(const std::optional<E> &value, std::string &out)
+            {
+                if (!value)
+                {
+                    out.append("null");
+                    return;
+                }
+                Writer<E>::write(value.value(), out);
+            }
+        };
+
+        template <typename E>
+        struct Writer<std::vector<E>>
+        {
+            static void write(const std::vector<E> &value, std::string &out)
+            {
+                out.push_back('[');
+                for (std::size_t i = 0; i < value.size(); ++i)
+                {
+                    if (i > 0)
+                    {
+                        out.push_back(',');
+                    }
+                    Writer<E>::write(value[i], out);
+                }
+                out.push_back(']');
+            }
+        };
+
+        /**
+         * The bytes written before a member value: the quoted name and a colon, preceded by a comma
+         * for every member but the first.
+         */
+        template <std::size_t Length>
+        struct KeyPrefix
+        {
+            std::array<char, Length> chars{};
+
+            constexpr std::string_view view() const
+            {
+                return std::string_view(this->chars.data(), Length);
+            }
+        };
+
+        template <std::size_t Length>
+        constexpr KeyPrefix<Length> make_key_prefix(std::string_view name, bool comma)
+        {
+            auto prefix = KeyPrefix<Length>{};
+            std::size_t i = 0;
+            if (comma)
+            {
+                prefix.chars[i++] = ',';
+            }
+            prefix.chars[i++] = '"';
+            for (auto c : name)
+            {
+                prefix.chars[i++] = c;
+            }
+            prefix.chars[i++] = '"';
+            prefix.chars[i++] = ':';
+            return prefix;
+        }
+
+        template <typename T>
+        struct Writer<T, std::enable_if_t<has_fields<T>::value>>
+        {
+            static constexpr const auto &fields = JsonFields<T>::fields;
+            static constexpr std::size_t size = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+
+            template <std::size_t I>
+            static constexpr auto prefix = make_key_prefix<std::get<I>(fields).name.size() + (I > 0 ? 4 : 3)>(
+                std::get<I>(fields).name, I > 0);
+
+            template <std::size_t I>
+            static void write_field(const T &value, std::string &out)
+            {
+                const auto &f = std::get<I>(fields);
+                out.append(prefix<I>.view());
+                Writer<typename std::decay_t<decltype(f)>::Member>::write(value.*(f.member), out);
+            }
+
+            template <std::size_t... I>
+            static void write_fields(const T &value, std::string &out, std::index_sequence<I...>)
+            {
+                (write_field<I>(value, out), ...);
+            }
+
+            static void write(const T &value, std::string &out)
+            {
+                out.push_back('{');
+                write_fields(value, out, std::make_index_sequence<size>{});
+                out.push_back('}');
+            }
+        };
+
+    }
+
+    /**
+     * Parses JSON directly into out without building a JsonValue. Members that are missing from
+     * the input keep their current value and unknown members are skipped, though still validated.
+     *
+     * @param json_str std::string_view containing valid JSON.
+     * @param out the value to fill. Throws std::runtime_error if the JSON is invalid or does not
+     * match the shape of T.
+     */
+    template <typename T>
+    void parse_into(std::string_view json_str, T &out)
+    {
+        auto input = typed::Input(json_str);
+        typed::Reader<T>::read(input, input.next(), out);
+        input.next();
+    }
+
+    /**
+     * Parses JSON directly into a default constructed T. See parse_into.
+     */
+    template <typename T>
+    T parse_as(std::string_view json_str)
+    {
+        auto out = T{};
+        parse_into(json_str, out);
+        return out;
+    }
+
+    /**
+     * Serializes value as JSON onto the end of out without building a JsonValue. Every described
+     * member is written, in declaration order, with std::nullopt written as null. Strings are written
+     * as they are stored, so they must already be escaped, like the strings in a JsonValue.
+     */
+    template <typename T>
+    void write_json(const T &value, std::string &out)
+    {
+        typed::Writer<T>::write(value, out);
+    }
+
+    /**
+     * Serializes value as JSON. See write_json.
+     */
+    template <typename T>
+    std::string to_json(const T &value)
+    {
+        auto out = std::string();
+        write_json(value, out);
+        return out;
+    }
+
+}
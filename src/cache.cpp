@@ -0,0 +1,245 @@
+#include "cache.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace jsonpp::cache
+{
+
+    namespace
+    {
+
+        constexpr std::uint64_t Multiplier = 0x9e3779b97f4a7c15ull;
+
+        /**
+         * A fast non-cryptographic hash of text, mixing in eight bytes at a time.
+         */
+        std::uint64_t hash_text(std::string_view text)
+        {
+            auto h = static_cast<std::uint64_t>(text.size()) * Multiplier;
+            std::size_t i = 0;
+            for (; i + sizeof(std::uint64_t) <= text.size(); i += sizeof(std::uint64_t))
+            {
+                std::uint64_t word;
+                std::memcpy(&word, text.data() + i, sizeof(word));
+                h = (h ^ word) * Multiplier;
+                h ^= h >> 32;
+            }
+            if (i < text.size())
+            {
+                std::uint64_t word = 0;
+                std::memcpy(&word, text.data() + i, text.size() - i);
+                h = (h ^ word) * Multiplier;
+            }
+
+            h ^= h >> 29;
+            h *= 0xbf58476d1ce4e5b9ull;
+            return h ^ (h >> 32);
+        }
+
+        /**
+         * Estimates the memory held by a tree like the allocation budget of ParseOptions does: every
+         * value node, object member and string byte.
+         *
+         * Walks the tree with an explicit stack, since the parser accepts documents nested far deeper
+         * than recursion could follow.
+         */
+        std::size_t tree_bytes(const JsonValue &value)
+        {
+            std::size_t bytes = 0;
+            auto pending = std::vector<const JsonValue *>{&value};
+            while (!pending.empty())
+            {
+                auto inner = pending.back()->value();
+                pending.pop_back();
+                bytes += sizeof(JsonValue);
+                if (!inner)
+                {
+                    continue;
+                }
+
+                bytes += sizeof(JsonValueVariant);
+                std::visit(utils::inline_visitor{
+                               [&](const JsonObject &o)
+                               {
+                                   for (const auto &[key, member] : o)
+                                   {
+                                       bytes += sizeof(JsonObject::value_type) + key.size();
+                                       pending.push_back(&member);
+                                   }
+                               },
+                               [&](const JsonArray &a)
+                               {
+                                   for (const auto &element : a)
+                                   {
+                                       pending.push_back(&element);
+                                   }
+                               },
+                               [&](const std::string &s)
+                               { bytes += s.size(); },
+                               [&](const JsonNumberArray &a)
+                               { bytes += a.size() * sizeof(double); },
+                               [&](const JsonRaw &r)
+                               { bytes += r.text.size(); },
+                               [](const auto &) {},
+                           },
+                           inner->get());
+            }
+            return bytes;
+        }
+
+    }
+
+    struct ParseCache::Shard
+    {
+        struct Entry
+        {
+            std::string text;
+            std::uint64_t hash;
+            JsonValue value;
+            std::size_t bytes;
+        };
+
+        // Points into the text of an entry, which does not move while the entry is cached.
+        struct Key
+        {
+            std::uint64_t hash;
+            std::string_view text;
+
+            bool operator==(const Key &other) const
+            {
+                return this->hash == other.hash && this->text == other.text;
+            }
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key &key) const
+            {
+                return static_cast<std::size_t>(key.hash);
+            }
+        };
+
+        /**
+         * Looks up a document and marks it as the most recently used.
+         */
+        const JsonValue *find(const Key &key)
+        {
+            auto it = this->index.find(key);
+            if (it == this->index.end())
+            {
+                return nullptr;
+            }
+            this->entries.splice(this->entries.begin(), this->entries, it->second);
+            return &it->second->value;
+        }
+
+        mutable std::mutex mutex;
+        // Most recently used first.
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        std::size_t bytes = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+    };
+
+    ParseCache::ParseCache(CacheOptions options) : m_options(std::move(options))
+    {
+        if (this->m_options.shards == 0)
+        {
+            throw std::runtime_error("ParseCache needs at least one shard");
+        }
+        this->m_shards = std::make_unique<Shard[]>(this->m_options.shards);
+    }
+
+    ParseCache::~ParseCache() = default;
+
+    JsonValue ParseCache::parse(std::string_view json_str)
+    {
+        auto hash = hash_text(json_str);
+        // The low bits pick the bucket inside the shard, so the shard is picked by the high ones.
+        auto &shard = this->m_shards[(hash >> 32) % this->m_options.shards];
+        {
+            auto lock = std::lock_guard<std::mutex>(shard.mutex);
+            if (auto cached = shard.find(Shard::Key{hash, json_str}))
+            {
+                ++shard.hits;
+                return *cached;
+            }
+            ++shard.misses;
+        }
+
+        auto value = JsonValue::parse(json_str, this->m_options.parse_options);
+        auto bytes = json_str.size() + tree_bytes(value);
+        auto budget = this->m_options.max_bytes / this->m_options.shards;
+        if (bytes > budget)
+        {
+            return value;
+        }
+
+        auto text = std::string(json_str);
+        // Evicted documents are freed after the lock is released, since tearing down a large tree
+        // takes a while.
+        auto evicted = std::vector<JsonValue>();
+        auto lock = std::lock_guard<std::mutex>(shard.mutex);
+        if (auto cached = shard.find(Shard::Key{hash, text}))
+        {
+            // Another thread parsed the same text in the meantime.
+            return *cached;
+        }
+
+        shard.entries.push_front(Shard::Entry{std::move(text), hash, value, bytes});
+        shard.index.emplace(Shard::Key{hash, shard.entries.front().text}, shard.entries.begin());
+        shard.bytes += bytes;
+        while (shard.bytes > budget)
+        {
+            auto &last = shard.entries.back();
+            shard.index.erase(Shard::Key{last.hash, last.text});
+            shard.bytes -= last.bytes;
+            evicted.push_back(std::move(last.value));
+            shard.entries.pop_back();
+            ++shard.evictions;
+        }
+        return value;
+    }
+
+    CacheStats ParseCache::stats() const
+    {
+        auto stats = CacheStats{};
+        for (std::size_t i = 0; i < this->m_options.shards; ++i)
+        {
+            const auto &shard = this->m_shards[i];
+            auto lock = std::lock_guard<std::mutex>(shard.mutex);
+            stats.hits += shard.hits;
+            stats.misses += shard.misses;
+            stats.evictions += shard.evictions;
+            stats.entries += shard.entries.size();
+            stats.bytes += shard.bytes;
+        }
+        return stats;
+    }
+
+    void ParseCache::clear()
+    {
+        for (std::size_t i = 0; i < this->m_options.shards; ++i)
+        {
+            auto &shard = this->m_shards[i];
+            auto entries = std::list<Shard::Entry>();
+            auto lock = std::lock_guard<std::mutex>(shard.mutex);
+            shard.index.clear();
+            shard.entries.swap(entries);
+            shard.bytes = 0;
+        }
+    }
+
+}
@@ -0,0 +1,636 @@
+#include "canonical.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace jsonpp::canonical
+{
+
+    namespace
+    {
+
+        // Output is handed to streaming sinks in chunks of about this size.
+        constexpr std::size_t ChunkSize = 4096;
+
+        class Sha256
+        {
+        public:
+            void update(std::string_view data)
+            {
+                this->m_length += data.size();
+                for (auto c : data)
+                {
+                    this->m_block[this->m_used++] = static_cast<std::uint8_t>(c);
+                    if (this->m_used == 64)
+                    {
+                        this->compress();
+                        this->m_used = 0;
+                    }
+                }
+            }
+
+            Digest finish()
+            {
+                auto bits = static_cast<std::uint64_t>(this->m_length) * 8;
+                this->m_block[this->m_used++] = 0x80;
+                if (this->m_used > 56)
+                {
+                    std::fill(this->m_block.begin() + this->m_used, this->m_block.end(), 0);
+                    this->compress();
+                    this->m_used = 0;
+                }
+                std::fill(this->m_block.begin() + this->m_used, this->m_block.begin() + 56, 0);
+                for (int i = 0; i < 8; ++i)
+                {
+                    this->m_block[63 - i] = static_cast<std::uint8_t>(bits >> (i * 8));
+                }
+                this->compress();
+
+                auto digest = Digest();
+                for (std::size_t i = 0; i < 8; ++i)
+                {
+                    for (std::size_t j = 0; j < 4; ++j)
+                    {
+                        digest[i * 4 + j] = static_cast<std::uint8_t>(this->m_state[i] >> (24 - j * 8));
+                    }
+                }
+                return digest;
+            }
+
+        private:
+            static std::uint32_t rotate(std::uint32_t x, int n)
+            {
+                return (x >> n) | (x << (32 - n));
+            }
+
+            void compress()
+            {
+                static constexpr std::uint32_t K[64] = {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+                };
+
+                std::uint32_t w[64];
+                for (std::size_t i = 0; i < 16; ++i)
+                {
+                    w[i] = static_cast<std::uint32_t>(this->m_block[i * 4]) << 24 |
+                           static_cast<std::uint32_t>(this->m_block[i * 4 + 1]) << 16 |
+                           static_cast<std::uint32_t>(this->m_block[i * 4 + 2]) << 8 |
+                           static_cast<std::uint32_t>(this->m_block[i * 4 + 3]);
+                }
+                for (std::size_t i = 16; i < 64; ++i)
+                {
+                    auto s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    auto s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                auto [a, b, c, d, e, f, g, h] = this->m_state;
+                for (std::size_t i = 0; i < 64; ++i)
+                {
+                    auto t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                    auto t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                this->m_state[0] += a;
+                this->m_state[1] += b;
+                this->m_state[2] += c;
+                this->m_state[3] += d;
+                this->m_state[4] += e;
+                this->m_state[5] += f;
+                this->m_state[6] += g;
+                this->m_state[7] += h;
+            }
+
+            std::array<std::uint32_t, 8> m_state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            std::array<std::uint8_t, 64> m_block = {};
+            std::size_t m_used = 0;
+            std::size_t m_length = 0;
+        };
+
+        unsigned hex_digit(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f')
+            {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F')
+            {
+                return c - 'A' + 10;
+            }
+            throw std::runtime_error("Invalid \\u escape in string");
+        }
+
+        char32_t read_hex4(std::string_view raw, std::size_t &i)
+        {
+            if (i + 4 > raw.size())
+            {
+                throw std::runtime_error("Invalid \\u escape in string");
+            }
+            char32_t code = 0;
+            for (std::size_t end = i + 4; i < end; ++i)
+            {
+                code = code * 16 + hex_digit(raw[i]);
+            }
+            return code;
+        }
+
+        /**
+         * @return the length of the UTF-8 sequence starting with byte, 0 if byte cannot start one.
+         */
+        std::size_t utf8_length(unsigned char byte)
+        {
+            if (byte < 0x80)
+            {
+                return 1;
+            }
+            if ((byte >> 5) == 0x6)
+            {
+                return 2;
+            }
+            if ((byte >> 4) == 0xe)
+            {
+                return 3;
+            }
+            if ((byte >> 3) == 0x1e)
+            {
+                return 4;
+            }
+            return 0;
+        }
+
+        /**
+         * Calls on_code_point with every code point of a string stored as it was written in JSON,
+         * resolving escapes and decoding UTF-8.
+         */
+        template <typename F>
+        void decode_string(std::string_view raw, F on_code_point)
+        {
+            std::size_t i = 0;
+            while (i < raw.size())
+            {
+                auto byte = static_cast<unsigned char>(raw[i]);
+                if (byte == '\\')
+                {
+                    if (++i == raw.size())
+                    {
+                        throw std::runtime_error("Unterminated escape in string");
+                    }
+                    auto escape = raw[i++];
+                    switch (escape)
+                    {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        on_code_point(static_cast<char32_t>(escape));
+                        break;
+                    case 'b':
+                        on_code_point(U'\b');
+                        break;
+                    case 'f':
+                        on_code_point(U'\f');
+                        break;
+                    case 'n':
+                        on_code_point(U'\n');
+                        break;
+                    case 'r':
+                        on_code_point(U'\r');
+                        break;
+                    case 't':
+                        on_code_point(U'\t');
+                        break;
+                    case 'u':
+                    {
+                        auto code = read_hex4(raw, i);
+                        if (code >= 0xdc00 && code <= 0xdfff)
+                        {
+                            throw std::runtime_error("Unpaired surrogate escape in string");
+                        }
+                        if (code >= 0xd800 && code <= 0xdbff)
+                        {
+                            if (i + 2 > raw.size() || raw[i] != '\\' || raw[i + 1] != 'u')
+                            {
+                                throw std::runtime_error("Unpaired surrogate escape in string");
+                            }
+                            i += 2;
+                            auto low = read_hex4(raw, i);
+                            if (low < 0xdc00 || low > 0xdfff)
+                            {
+                                throw std::runtime_error("Unpaired surrogate escape in string");
+                            }
+                            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        }
+                        on_code_point(code);
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error("Invalid escape in string");
+                    }
+                    continue;
+                }
+
+                // Plain UTF-8.
+                auto length = utf8_length(byte);
+                if (length == 0 || i + length > raw.size())
+                {
+                    throw std::runtime_error("Invalid UTF-8 in string");
+                }
+                char32_t code = length == 1 ? byte : byte & (0x7f >> length);
+                for (std::size_t j = 1; j < length; ++j)
+                {
+                    auto next = static_cast<unsigned char>(raw[i + j]);
+                    if ((next & 0xc0) != 0x80)
+                    {
+                        throw std::runtime_error("Invalid UTF-8 in string");
+                    }
+                    code = (code << 6) | (next & 0x3f);
+                }
+                // Overlong forms, encoded surrogates and code points past U+10FFFF are not valid UTF-8.
+                static constexpr char32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+                if (code < minimum[length] || (code >= 0xd800 && code <= 0xdfff) || code > 0x10ffff)
+                {
+                    throw std::runtime_error("Invalid UTF-8 in string");
+                }
+                i += length;
+                on_code_point(code);
+            }
+        }
+
+        /**
+         * @return the decoded string as UTF-16 code units, which is the order RFC 8785 sorts names in.
+         */
+        std::u16string utf16_key(std::string_view raw)
+        {
+            auto out = std::u16string();
+            auto append = [&out](char32_t code)
+            {
+                if (code >= 0x10000)
+                {
+                    code -= 0x10000;
+                    out.push_back(static_cast<char16_t>(0xd800 + (code >> 10)));
+                    out.push_back(static_cast<char16_t>(0xdc00 + (code & 0x3ff)));
+                }
+                else
+                {
+                    out.push_back(static_cast<char16_t>(code));
+                }
+            };
+            decode_string(raw, append);
+            return out;
+        }
+
+        class Writer
+        {
+        public:
+            explicit Writer(const std::function<void(std::string_view)> *sink) : m_sink(sink) {}
+
+            /**
+             * Writes a value. Arrays and objects are kept on an explicit stack, so deep values cannot
+             * overflow the call stack.
+             */
+            void value(const JsonValue &value)
+            {
+                this->start(value);
+                while (!this->m_stack.empty())
+                {
+                    // start may push onto the stack, which can move the frame being visited, so every
+                    // frame is updated before it is called.
+                    std::visit(utils::inline_visitor{
+                                   [this](ObjectFrame &frame)
+                                   {
+                                       if (frame.index == frame.members.size())
+                                       {
+                                           this->m_out.push_back('}');
+                                           this->m_stack.pop_back();
+                                           return;
+                                       }
+                                       if (frame.index > 0)
+                                       {
+                                           this->m_out.push_back(',');
+                                       }
+                                       const auto &member = *frame.members[frame.index++].second;
+                                       this->string(member.first);
+                                       this->m_out.push_back(':');
+                                       this->start(member.second);
+                                   },
+                                   [this](ArrayFrame &frame)
+                                   {
+                                       if (frame.index == frame.elements->size())
+                                       {
+                                           this->m_out.push_back(']');
+                                           this->m_stack.pop_back();
+                                           return;
+                                       }
+                                       if (frame.index > 0)
+                                       {
+                                           this->m_out.push_back(',');
+                                       }
+                                       this->start((*frame.elements)[frame.index++]);
+                                   },
+                                   [this](RawFrame &frame)
+                                   {
+                                       if (frame.written)
+                                       {
+                                           this->m_stack.pop_back();
+                                           return;
+                                       }
+                                       frame.written = true;
+                                       auto parsed = frame.value;
+                                       this->start(parsed);
+                                   },
+                               },
+                               this->m_stack.back());
+                }
+            }
+
+            void flush(bool all)
+            {
+                if (this->m_sink && (all || this->m_out.size() >= ChunkSize))
+                {
+                    (*this->m_sink)(this->m_out);
+                    this->m_out.clear();
+                }
+            }
+
+            std::string take() { return std::move(this->m_out); }
+
+        private:
+            struct ObjectFrame
+            {
+                // Members sorted by name.
+                std::vector<std::pair<std::u16string, const JsonObject::value_type *>> members;
+                std::size_t index;
+            };
+
+            struct ArrayFrame
+            {
+                const JsonArray *elements;
+                std::size_t index;
+            };
+
+            /**
+             * Keeps a value parsed from raw text alive while it is written.
+             */
+            struct RawFrame
+            {
+                JsonValue value;
+                bool written;
+            };
+
+            using Frame = std::variant<ObjectFrame, ArrayFrame, RawFrame>;
+
+            /**
+             * Writes a scalar, or the opening bracket of an array or object and pushes its frame.
+             */
+            void start(const JsonValue &value)
+            {
+                auto inner = value.value();
+                if (!inner)
+                {
+                    this->m_out.append("null");
+                    return;
+                }
+
+                std::visit(
+                    utils::inline_visitor{
+                        [this](const JsonObject &o)
+                        { this->object(o); },
+                        [this](const JsonArray &a)
+                        {
+                            this->m_out.push_back('[');
+                            this->m_stack.push_back(ArrayFrame{&a, 0});
+                        },
+                        [this](const std::string &s)
+                        { this->string(s); },
+                        [this](const double &d)
+                        { this->number(d); },
+                        [this](const bool &b)
+                        { this->m_out.append(b ? "true" : "false"); },
+                        [this](const JsonNumberArray &a)
+                        { this->numbers(a); },
+                        [this](const JsonRaw &r)
+                        { this->m_stack.push_back(RawFrame{JsonValue::parse(r.text), false}); },
+                    },
+                    inner->get());
+                this->flush(false);
+            }
+
+            void object(const JsonObject &o)
+            {
+                auto members = std::vector<std::pair<std::u16string, const JsonObject::value_type *>>();
+                members.reserve(o.size());
+                for (const auto &member : o)
+                {
+                    members.emplace_back(utf16_key(member.first), &member);
+                }
+                std::sort(members.begin(), members.end(), [](const auto &a, const auto &b)
+                          { return a.first < b.first; });
+
+                this->m_out.push_back('{');
+                this->m_stack.push_back(ObjectFrame{std::move(members), 0});
+            }
+
+            void numbers(const JsonNumberArray &a)
+            {
+                this->m_out.push_back('[');
+                for (std::size_t i = 0; i < a.size(); ++i)
+                {
+                    if (i > 0)
+                    {
+                        this->m_out.push_back(',');
+                    }
+                    this->number(a[i]);
+                    this->flush(false);
+                }
+                this->m_out.push_back(']');
+            }
+
+            void string(std::string_view raw)
+            {
+                static constexpr char hex[] = "0123456789abcdef";
+
+                auto &out = this->m_out;
+                auto append = [&out](char32_t code)
+                {
+                    switch (code)
+                    {
+                    case U'"':
+                        out.append("\\\"");
+                        return;
+                    case U'\\':
+                        out.append("\\\\");
+                        return;
+                    case U'\b':
+                        out.append("\\b");
+                        return;
+                    case U'\f':
+                        out.append("\\f");
+                        return;
+                    case U'\n':
+                        out.append("\\n");
+                        return;
+                    case U'\r':
+                        out.append("\\r");
+                        return;
+                    case U'\t':
+                        out.append("\\t");
+                        return;
+                    }
+
+                    if (code < 0x20)
+                    {
+                        out.append("\\u00");
+                        out.push_back(hex[code >> 4]);
+                        out.push_back(hex[code & 0xf]);
+                    }
+                    else if (code < 0x80)
+                    {
+                        out.push_back(static_cast<char>(code));
+                    }
+                    else if (code < 0x800)
+                    {
+                        out.push_back(static_cast<char>(0xc0 | (code >> 6)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                    }
+                    else if (code < 0x10000)
+                    {
+                        out.push_back(static_cast<char>(0xe0 | (code >> 12)));
+                        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                    }
+                    else
+                    {
+                        out.push_back(static_cast<char>(0xf0 | (code >> 18)));
+                        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                        out.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                    }
+                };
+
+                out.push_back('"');
+                decode_string(raw, append);
+                this->m_out.push_back('"');
+            }
+
+            /**
+             * Writes a number the way ECMAScript's Number.prototype.toString does.
+             */
+            void number(double d)
+            {
+                if (!std::isfinite(d))
+                {
+                    throw std::runtime_error("Canonical JSON cannot represent NaN or infinite numbers");
+                }
+                if (d == 0)
+                {
+                    this->m_out.push_back('0');
+                    return;
+                }
+                if (d < 0)
+                {
+                    this->m_out.push_back('-');
+                    d = -d;
+                }
+
+                // Shortest round-tripping digits, as "d.ddde+XX".
+                char buffer[32];
+                auto res = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::scientific);
+                auto text = std::string_view(buffer, res.ptr - buffer);
+                auto e = text.find('e');
+
+                auto digits = std::string(text.substr(0, e));
+                digits.erase(std::remove(digits.begin(), digits.end(), '.'), digits.end());
+                auto k = static_cast<int>(digits.size());
+                // Position of the decimal point relative to the first digit.
+                int exponent = 0;
+                auto sign = text[e + 1] == '+' ? 2 : 1;
+                std::from_chars(text.data() + e + sign, text.data() + text.size(), exponent);
+                auto n = exponent + 1;
+
+                if (k <= n && n <= 21)
+                {
+                    this->m_out.append(digits);
+                    this->m_out.append(n - k, '0');
+                }
+                else if (0 < n && n <= 21)
+                {
+                    this->m_out.append(digits, 0, n);
+                    this->m_out.push_back('.');
+                    this->m_out.append(digits, n);
+                }
+                else if (-6 < n && n <= 0)
+                {
+                    this->m_out.append("0.");
+                    this->m_out.append(-n, '0');
+                    this->m_out.append(digits);
+                }
+                else
+                {
+                    this->m_out.push_back(digits[0]);
+                    if (k > 1)
+                    {
+                        this->m_out.push_back('.');
+                        this->m_out.append(digits, 1);
+                    }
+                    this->m_out.push_back('e');
+                    this->m_out.push_back(n - 1 < 0 ? '-' : '+');
+                    this->m_out.append(std::to_string(std::abs(n - 1)));
+                }
+            }
+
+            const std::function<void(std::string_view)> *m_sink;
+            std::string m_out;
+            std::vector<Frame> m_stack;
+        };
+
+    }
+
+    std::string serialize(const JsonValue &value)
+    {
+        auto writer = Writer(nullptr);
+        writer.value(value);
+        return writer.take();
+    }
+
+    void serialize(const JsonValue &value, const std::function<void(std::string_view)> &sink)
+    {
+        auto writer = Writer(&sink);
+        writer.value(value);
+        writer.flush(true);
+    }
+
+    Digest digest(const JsonValue &value)
+    {
+        auto hash = Sha256();
+        serialize(value, [&hash](std::string_view chunk)
+                  { hash.update(chunk); });
+        return hash.finish();
+    }
+
+}
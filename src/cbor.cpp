@@ -0,0 +1,613 @@
+#include "cbor.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+#include "lexer.hpp"
+#include "utils.hpp"
+#include "scanner.hpp"
+
+namespace jsonpp::cbor
+{
+
+    namespace
+    {
+
+        enum MajorType : std::uint8_t
+        {
+            UnsignedInt = 0,
+            NegativeInt = 1,
+            ByteString = 2,
+            TextString = 3,
+            Array = 4,
+            Map = 5,
+            Tag = 6,
+            Simple = 7,
+        };
+
+        constexpr std::uint8_t False = 0xf4;
+        constexpr std::uint8_t True = 0xf5;
+        constexpr std::uint8_t Null = 0xf6;
+        constexpr std::uint8_t Undefined = 0xf7;
+        constexpr std::uint8_t Float16 = 0xf9;
+        constexpr std::uint8_t Float32 = 0xfa;
+        constexpr std::uint8_t Float64 = 0xfb;
+        constexpr std::uint8_t Break = 0xff;
+        constexpr std::uint8_t Indefinite = 31;
+
+        void write_big_endian(std::uint64_t value, int bytes, std::vector<std::uint8_t> &out)
+        {
+            for (int i = bytes - 1; i >= 0; --i)
+            {
+                out.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+            }
+        }
+
+        void write_head(MajorType major, std::uint64_t value, std::vector<std::uint8_t> &out)
+        {
+            auto type = static_cast<std::uint8_t>(major << 5);
+            if (value < 24)
+            {
+                out.push_back(type | static_cast<std::uint8_t>(value));
+            }
+            else if (value <= 0xff)
+            {
+                out.push_back(type | 24);
+                write_big_endian(value, 1, out);
+            }
+            else if (value <= 0xffff)
+            {
+                out.push_back(type | 25);
+                write_big_endian(value, 2, out);
+            }
+            else if (value <= 0xffffffff)
+            {
+                out.push_back(type | 26);
+                write_big_endian(value, 4, out);
+            }
+            else
+            {
+                out.push_back(type | 27);
+                write_big_endian(value, 8, out);
+            }
+        }
+
+        void write_text(std::string_view s, std::vector<std::uint8_t> &out)
+        {
+            write_head(TextString, s.size(), out);
+            out.insert(out.end(), s.begin(), s.end());
+        }
+
+        void write_number(double d, std::vector<std::uint8_t> &out)
+        {
+            // Like JsonValue::json, since decode rejects NaN and infinity.
+            if (!std::isfinite(d))
+            {
+                out.push_back(Null);
+                return;
+            }
+
+            // Integers up to 2^53 are exact in a double, so they round trip through a CBOR integer.
+            if (std::trunc(d) == d && std::fabs(d) < 9007199254740992.0 && !(d == 0 && std::signbit(d)))
+            {
+                if (d >= 0)
+                {
+                    write_head(UnsignedInt, static_cast<std::uint64_t>(d), out);
+                }
+                else
+                {
+                    write_head(NegativeInt, static_cast<std::uint64_t>(-1 - d), out);
+                }
+            }
+            else if (static_cast<double>(static_cast<float>(d)) == d)
+            {
+                auto f = static_cast<float>(d);
+                std::uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                out.push_back(Float32);
+                write_big_endian(bits, 4, out);
+            }
+            else
+            {
+                std::uint64_t bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                out.push_back(Float64);
+                write_big_endian(bits, 8, out);
+            }
+        }
+
+        struct ObjectFrame
+        {
+            JsonObject::const_iterator it;
+            JsonObject::const_iterator end;
+        };
+
+        struct ArrayFrame
+        {
+            JsonArray::const_iterator it;
+            JsonArray::const_iterator end;
+        };
+
+        using EncodeFrame = std::variant<ObjectFrame, ArrayFrame>;
+
+        /**
+         * Writes a scalar, or the head of an array or map whose items are left on the stack.
+         */
+        struct ToCborVisitor
+        {
+            void operator()(const JsonObject &o) const
+            {
+                write_head(Map, o.size(), this->out);
+                this->stack.push_back(ObjectFrame{o.begin(), o.end()});
+            }
+
+            void operator()(const JsonArray &a) const
+            {
+                write_head(Array, a.size(), this->out);
+                this->stack.push_back(ArrayFrame{a.begin(), a.end()});
+            }
+
+            void operator()(const std::string &s) const
+            {
+                write_text(s, this->out);
+            }
+
+            void operator()(const double &d) const
+            {
+                write_number(d, this->out);
+            }
+
+            void operator()(const bool &b) const
+            {
+                this->out.push_back(b ? True : False);
+            }
+
+            void operator()(const JsonNumberArray &a) const
+            {
+                write_head(Array, a.size(), this->out);
+                for (auto d : a)
+                {
+                    write_number(d, this->out);
+                }
+            }
+
+            void operator()(const JsonRaw &r) const
+            {
+                auto bytes = transcode(r.text);
+                this->out.insert(this->out.end(), bytes.begin(), bytes.end());
+            }
+
+            std::vector<std::uint8_t> &out;
+            std::vector<EncodeFrame> &stack;
+        };
+
+        void write_value(const JsonValue &value, std::vector<std::uint8_t> &out, std::vector<EncodeFrame> &stack)
+        {
+            if (auto inner = value.value())
+            {
+                std::visit(ToCborVisitor{out, stack}, inner->get());
+            }
+            else
+            {
+                out.push_back(Null);
+            }
+        }
+
+        double decode_half(std::uint16_t half)
+        {
+            auto exponent = (half >> 10) & 0x1f;
+            auto mantissa = half & 0x3ff;
+            double value;
+            if (exponent == 0)
+            {
+                value = std::ldexp(mantissa, -24);
+            }
+            else if (exponent != 31)
+            {
+                value = std::ldexp(mantissa + 1024, exponent - 25);
+            }
+            else
+            {
+                value = mantissa == 0 ? INFINITY : NAN;
+            }
+            return half & 0x8000 ? -value : value;
+        }
+
+        /**
+         * Turns the text of a CBOR string into the escaped form JsonValue stores. Escapes are kept as
+         * they are, so strings written by encode come back unchanged. Quotes and control characters
+         * are escaped, and a backslash that does not start a valid escape is rejected.
+         */
+        std::string to_json_text(std::string s)
+        {
+            // Only built once something needs escaping, from the parts of s checked so far.
+            auto out = std::string();
+            std::size_t copied = 0;
+            std::size_t i = 0;
+            while (i < s.size())
+            {
+                auto c = static_cast<unsigned char>(s[i]);
+                if (c == '\\')
+                {
+                    auto length = i + 1 < s.size() && s[i + 1] == 'u' ? 6 : 2;
+                    if (i + 1 == s.size() || !lex::is_escape(s[i + 1]) || i + length > s.size())
+                    {
+                        throw std::runtime_error("Invalid escape in CBOR text string");
+                    }
+                    for (std::size_t j = i + 2; j < i + length; ++j)
+                    {
+                        if (!lex::is_hex(s[j]))
+                        {
+                            throw std::runtime_error("Invalid escape in CBOR text string");
+                        }
+                    }
+                    i += length;
+                    continue;
+                }
+                if (c == '"' || c < 0x20)
+                {
+                    static const char *hex = "0123456789abcdef";
+                    out.append(s, copied, i - copied);
+                    out.append(c == '"' ? std::string("\\\"") : std::string("\\u00") + hex[c >> 4] + hex[c & 0xf]);
+                    copied = i + 1;
+                }
+                ++i;
+            }
+
+            if (copied == 0)
+            {
+                return s;
+            }
+            out.append(s, copied);
+            return out;
+        }
+
+        double finite(double d)
+        {
+            if (!std::isfinite(d))
+            {
+                throw std::runtime_error("CBOR NaN and infinity cannot be represented as JSON");
+            }
+            return d;
+        }
+
+        class Decoder
+        {
+        public:
+            Decoder(const std::uint8_t *data, std::size_t size, const ParseOptions &options)
+                : m_data(data), m_size(size), m_options(options) {}
+
+            /**
+             * Decodes one data item. Arrays and maps are kept on an explicit stack, so hostile input
+             * cannot overflow the call stack however deeply it nests.
+             */
+            JsonValue decode_item()
+            {
+                auto stack = std::vector<Frame>();
+                while (1)
+                {
+                    auto value = std::optional<JsonValue>();
+                    if (!stack.empty())
+                    {
+                        auto &frame = stack.back();
+                        if (frame.indefinite ? this->read_break() : frame.remaining == 0)
+                        {
+                            if (frame.object)
+                            {
+                                value.emplace(std::move(frame.members));
+                            }
+                            else
+                            {
+                                value.emplace(std::move(frame.elements));
+                            }
+                            stack.pop_back();
+                        }
+                        else if (frame.object)
+                        {
+                            auto key = this->read_byte();
+                            if (key >> 5 != TextString)
+                            {
+                                throw std::runtime_error("CBOR map keys must be text strings");
+                            }
+                            frame.key = to_json_text(this->read_text(key & 0x1f));
+                        }
+                    }
+                    if (!value)
+                    {
+                        value = this->read_value(stack);
+                        if (!value)
+                        {
+                            continue;
+                        }
+                    }
+
+                    if (stack.empty())
+                    {
+                        return std::move(*value);
+                    }
+                    auto &parent = stack.back();
+                    if (parent.object)
+                    {
+                        parent.members.insert({std::move(parent.key), std::move(*value)});
+                    }
+                    else
+                    {
+                        parent.elements.push_back(std::move(*value));
+                    }
+                    if (!parent.indefinite)
+                    {
+                        --parent.remaining;
+                    }
+                }
+            }
+
+            bool at_end() const { return this->m_pos == this->m_size; }
+
+        private:
+            struct Frame
+            {
+                bool object;
+                bool indefinite;
+                // Items left in a definite-length array or map.
+                std::uint64_t remaining;
+                JsonArray elements;
+                JsonObject members;
+                // Key of the member being decoded.
+                std::string key;
+            };
+
+            /**
+             * Reads the next scalar, or starts an array or map on the stack and returns nothing.
+             */
+            std::optional<JsonValue> read_value(std::vector<Frame> &stack)
+            {
+                auto initial = this->read_byte();
+                // Tags are skipped, however many there are.
+                while (initial >> 5 == Tag)
+                {
+                    this->read_argument(initial & 0x1f);
+                    initial = this->read_byte();
+                }
+                auto major = static_cast<MajorType>(initial >> 5);
+                auto info = static_cast<std::uint8_t>(initial & 0x1f);
+
+                switch (major)
+                {
+                case UnsignedInt:
+                    return JsonValue(static_cast<double>(this->read_argument(info)));
+                case NegativeInt:
+                    return JsonValue(-1 - static_cast<double>(this->read_argument(info)));
+                case ByteString:
+                    throw std::runtime_error("CBOR byte strings cannot be represented as JSON");
+                case TextString:
+                    return JsonValue(to_json_text(this->read_text(info)));
+                case Array:
+                case Map:
+                {
+                    if (stack.size() >= this->m_options.max_depth)
+                    {
+                        throw std::runtime_error("CBOR exceeds the maximum nesting depth");
+                    }
+                    auto indefinite = info == Indefinite;
+                    auto remaining = indefinite ? 0 : this->read_argument(info);
+                    stack.push_back(Frame{major == Map, indefinite, remaining, JsonArray(), JsonObject(), std::string()});
+                    return std::nullopt;
+                }
+                case Tag:
+                    break;
+                case Simple:
+                    switch (initial)
+                    {
+                    case False:
+                        return JsonValue(false);
+                    case True:
+                        return JsonValue(true);
+                    case Null:
+                    case Undefined:
+                        return JsonValue(nullptr);
+                    case Float16:
+                        return JsonValue(finite(decode_half(static_cast<std::uint16_t>(this->read_big_endian(2)))));
+                    case Float32:
+                    {
+                        auto bits = static_cast<std::uint32_t>(this->read_big_endian(4));
+                        float f;
+                        std::memcpy(&f, &bits, sizeof(f));
+                        return JsonValue(finite(static_cast<double>(f)));
+                    }
+                    case Float64:
+                    {
+                        auto bits = this->read_big_endian(8);
+                        double d;
+                        std::memcpy(&d, &bits, sizeof(d));
+                        return JsonValue(finite(d));
+                    }
+                    }
+                    throw std::runtime_error("Unsupported CBOR simple value");
+                }
+
+                throw std::runtime_error("Invalid CBOR major type");
+            }
+
+            std::uint8_t read_byte()
+            {
+                if (this->m_pos >= this->m_size)
+                {
+                    throw std::runtime_error("Unexpected end of CBOR input");
+                }
+                return this->m_data[this->m_pos++];
+            }
+
+            std::uint64_t read_big_endian(int bytes)
+            {
+                std::uint64_t value = 0;
+                for (int i = 0; i < bytes; ++i)
+                {
+                    value = (value << 8) | this->read_byte();
+                }
+                return value;
+            }
+
+            std::uint64_t read_argument(std::uint8_t info)
+            {
+                if (info < 24)
+                {
+                    return info;
+                }
+                switch (info)
+                {
+                case 24:
+                    return this->read_big_endian(1);
+                case 25:
+                    return this->read_big_endian(2);
+                case 26:
+                    return this->read_big_endian(4);
+                case 27:
+                    return this->read_big_endian(8);
+                }
+                throw std::runtime_error("Invalid CBOR additional information");
+            }
+
+            bool read_break()
+            {
+                if (this->m_pos < this->m_size && this->m_data[this->m_pos] == Break)
+                {
+                    ++this->m_pos;
+                    return true;
+                }
+                return false;
+            }
+
+            std::string read_text(std::uint8_t info)
+            {
+                if (info == Indefinite)
+                {
+                    auto s = std::string();
+                    while (!this->read_break())
+                    {
+                        auto chunk = this->read_byte();
+                        if (chunk >> 5 != TextString || (chunk & 0x1f) == Indefinite)
+                        {
+                            throw std::runtime_error("Invalid chunk in indefinite-length CBOR text string");
+                        }
+                        s.append(this->read_text(chunk & 0x1f));
+                    }
+                    return s;
+                }
+
+                auto length = this->read_argument(info);
+                if (length > this->m_size - this->m_pos)
+                {
+                    throw std::runtime_error("Unexpected end of CBOR input");
+                }
+                auto s = std::string(reinterpret_cast<const char *>(this->m_data + this->m_pos), length);
+                this->m_pos += length;
+                return s;
+            }
+
+            const std::uint8_t *m_data;
+            std::size_t m_size;
+            const ParseOptions &m_options;
+            std::size_t m_pos = 0;
+        };
+
+    }
+
+    std::vector<std::uint8_t> encode(const JsonValue &value)
+    {
+        auto out = std::vector<std::uint8_t>();
+        // Arrays and maps are kept on an explicit stack, like the decoder, so deep values cannot
+        // overflow the call stack.
+        auto stack = std::vector<EncodeFrame>();
+        write_value(value, out, stack);
+        while (!stack.empty())
+        {
+            // write_value may push onto the stack, so the frame is advanced before it is called.
+            auto next = std::visit(utils::inline_visitor{
+                                       [&out](ObjectFrame &frame) -> const JsonValue *
+                                       {
+                                           if (frame.it == frame.end)
+                                           {
+                                               return nullptr;
+                                           }
+                                           const auto &[key, member] = *frame.it++;
+                                           write_text(key, out);
+                                           return &member;
+                                       },
+                                       [](ArrayFrame &frame) -> const JsonValue *
+                                       {
+                                           return frame.it == frame.end ? nullptr : &*frame.it++;
+                                       },
+                                   },
+                                   stack.back());
+            if (next)
+            {
+                write_value(*next, out, stack);
+            }
+            else
+            {
+                stack.pop_back();
+            }
+        }
+        return out;
+    }
+
+    JsonValue decode(const std::uint8_t *data, std::size_t size, const ParseOptions &options)
+    {
+        auto decoder = Decoder(data, size, options);
+        auto value = decoder.decode_item();
+        if (!decoder.at_end())
+        {
+            throw std::runtime_error("Extraneous input after CBOR");
+        }
+        return value;
+    }
+
+    JsonValue decode(const std::vector<std::uint8_t> &data, const ParseOptions &options)
+    {
+        return decode(data.data(), data.size(), options);
+    }
+
+    std::vector<std::uint8_t> transcode(std::string_view json_str)
+    {
+        auto out = std::vector<std::uint8_t>();
+        out.reserve(json_str.size());
+
+        auto tokenizer = scan::Tokenizer(json_str);
+        while (1)
+        {
+            auto token = tokenizer.next();
+            switch (token.type)
+            {
+            case scan::BeginObject:
+                out.push_back(static_cast<std::uint8_t>(Map << 5) | Indefinite);
+                break;
+            case scan::BeginArray:
+                out.push_back(static_cast<std::uint8_t>(Array << 5) | Indefinite);
+                break;
+            case scan::EndObject:
+            case scan::EndArray:
+                out.push_back(Break);
+                break;
+            case scan::Key:
+            case scan::String:
+                write_text(token.text, out);
+                break;
+            case scan::Number:
+                // Same conversion as JsonValue::parse.
+                write_number(lex::to_double(token.text), out);
+                break;
+            case scan::Literal:
+                out.push_back(token.text == "true" ? True : token.text == "false" ? False
+                                                                                   : Null);
+                break;
+            case scan::End:
+                return out;
+            }
+        }
+    }
+
+}
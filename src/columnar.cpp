@@ -0,0 +1,281 @@
+#include "columnar.hpp"
+
+#include <stdexcept>
+
+#include "lexer.hpp"
+#include "scanner.hpp"
+#include "utils.hpp"
+
+namespace jsonpp::columnar
+{
+
+    namespace
+    {
+
+        // Marks a member that is not extracted in Shape.
+        constexpr std::size_t Skipped = static_cast<std::size_t>(-1);
+
+        /**
+         * The members of the previous record in order and the column each one went to, so a record of
+         * the same shape resolves every member with a single comparison.
+         */
+        struct Shape
+        {
+            std::vector<std::string_view> keys;
+            std::vector<std::size_t> columns;
+        };
+
+        Table make_table(const std::vector<ColumnSpec> &columns)
+        {
+            auto table = Table();
+            table.columns.reserve(columns.size());
+            for (const auto &spec : columns)
+            {
+                auto values = ColumnValues(NumberColumn{});
+                switch (spec.type)
+                {
+                case NumberType:
+                    break;
+                case StringType:
+                    values = StringColumn{};
+                    break;
+                case BoolType:
+                    values = BoolColumn{};
+                    break;
+                }
+                table.columns.push_back(Column{spec.name, std::move(values), {}});
+            }
+            return table;
+        }
+
+        [[noreturn]] void type_mismatch(const Column &column, const char *expected)
+        {
+            throw std::runtime_error("JSON member \"" + column.name + "\" is not a " + expected);
+        }
+
+        void append_missing(Column &column)
+        {
+            std::visit(utils::inline_visitor{
+                           [](NumberColumn &c)
+                           { c.values.push_back(0); },
+                           [](StringColumn &c)
+                           { c.offsets.push_back(c.blob.size()); },
+                           [](BoolColumn &c)
+                           { c.values.push_back(0); },
+                       },
+                       column.values);
+            column.valid.push_back(0);
+        }
+
+        void append_token(Column &column, const scan::Token &token)
+        {
+            if (token.type == scan::Literal && token.text == "null")
+            {
+                append_missing(column);
+                return;
+            }
+
+            std::visit(utils::inline_visitor{
+                           [&](NumberColumn &c)
+                           {
+                               if (token.type != scan::Number)
+                               {
+                                   type_mismatch(column, "number");
+                               }
+                               c.values.push_back(lex::to_double(token.text));
+                           },
+                           [&](StringColumn &c)
+                           {
+                               if (token.type != scan::String)
+                               {
+                                   type_mismatch(column, "string");
+                               }
+                               c.blob.append(token.text);
+                               c.offsets.push_back(c.blob.size());
+                           },
+                           [&](BoolColumn &c)
+                           {
+                               if (token.type != scan::Literal)
+                               {
+                                   type_mismatch(column, "boolean");
+                               }
+                               c.values.push_back(token.text == "true");
+                           },
+                       },
+                       column.values);
+            column.valid.push_back(1);
+        }
+
+        void append_value(Column &column, const JsonValue &value)
+        {
+            auto inner = value.value();
+            if (!inner)
+            {
+                append_missing(column);
+                return;
+            }
+
+            std::visit(utils::inline_visitor{
+                           [&](NumberColumn &c)
+                           {
+                               auto d = std::get_if<double>(&inner->get());
+                               if (!d)
+                               {
+                                   type_mismatch(column, "number");
+                               }
+                               c.values.push_back(*d);
+                           },
+                           [&](StringColumn &c)
+                           {
+                               auto s = std::get_if<std::string>(&inner->get());
+                               if (!s)
+                               {
+                                   type_mismatch(column, "string");
+                               }
+                               c.blob.append(*s);
+                               c.offsets.push_back(c.blob.size());
+                           },
+                           [&](BoolColumn &c)
+                           {
+                               auto b = std::get_if<bool>(&inner->get());
+                               if (!b)
+                               {
+                                   type_mismatch(column, "boolean");
+                               }
+                               c.values.push_back(*b);
+                           },
+                       },
+                       column.values);
+            column.valid.push_back(1);
+        }
+
+        std::size_t find_column(const Table &table, std::string_view key)
+        {
+            for (std::size_t i = 0; i < table.columns.size(); ++i)
+            {
+                if (table.columns[i].name == key)
+                {
+                    return i;
+                }
+            }
+            return Skipped;
+        }
+
+        /**
+         * Pads the columns the record did not have and counts the row.
+         */
+        void end_row(Table &table)
+        {
+            ++table.rows;
+            for (auto &column : table.columns)
+            {
+                if (column.valid.size() < table.rows)
+                {
+                    append_missing(column);
+                }
+            }
+        }
+
+    }
+
+    Table extract(std::string_view json_str, const std::vector<ColumnSpec> &columns)
+    {
+        auto table = make_table(columns);
+        auto tokenizer = scan::Tokenizer(json_str);
+        if (tokenizer.next().type != scan::BeginArray)
+        {
+            throw std::runtime_error("Expected a JSON array of objects");
+        }
+
+        auto shape = Shape();
+        while (1)
+        {
+            auto token = tokenizer.next();
+            if (token.type == scan::EndArray)
+            {
+                break;
+            }
+            if (token.type != scan::BeginObject)
+            {
+                throw std::runtime_error("Expected a JSON object in the array");
+            }
+
+            std::size_t member = 0;
+            while ((token = tokenizer.next()).type == scan::Key)
+            {
+                if (member == shape.keys.size())
+                {
+                    shape.keys.push_back(token.text);
+                    shape.columns.push_back(find_column(table, token.text));
+                }
+                else if (shape.keys[member] != token.text)
+                {
+                    shape.keys[member] = token.text;
+                    shape.columns[member] = find_column(table, token.text);
+                }
+
+                auto index = shape.columns[member++];
+                if (index == Skipped || table.columns[index].valid.size() > table.rows)
+                {
+                    tokenizer.skip_value();
+                    continue;
+                }
+
+                // Containers fail the type check like any other mismatch.
+                append_token(table.columns[index], tokenizer.next());
+            }
+            end_row(table);
+        }
+
+        if (tokenizer.next().type != scan::End)
+        {
+            throw std::runtime_error("Extraneous input after JSON");
+        }
+        return table;
+    }
+
+    Table pivot(const JsonValue &array, const std::vector<ColumnSpec> &columns)
+    {
+        auto table = make_table(columns);
+        auto inner = array.value();
+        auto elements = inner ? std::get_if<JsonArray>(&inner->get()) : nullptr;
+        if (!elements)
+        {
+            throw std::runtime_error("Expected a JSON array of objects");
+        }
+
+        for (auto &column : table.columns)
+        {
+            column.valid.reserve(elements->size());
+            std::visit(utils::inline_visitor{
+                           [&](StringColumn &c)
+                           { c.offsets.reserve(elements->size() + 1); },
+                           [&](auto &c)
+                           { c.values.reserve(elements->size()); },
+                       },
+                       column.values);
+        }
+
+        for (const auto &element : *elements)
+        {
+            auto element_inner = element.value();
+            auto object = element_inner ? std::get_if<JsonObject>(&element_inner->get()) : nullptr;
+            if (!object)
+            {
+                throw std::runtime_error("Expected a JSON object in the array");
+            }
+
+            for (auto &column : table.columns)
+            {
+                auto it = object->find(column.name);
+                if (it != object->end())
+                {
+                    append_value(column, it->second);
+                }
+            }
+            end_row(table);
+        }
+        return table;
+    }
+
+}
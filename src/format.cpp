@@ -0,0 +1,246 @@
+#include "format.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include "lexer.hpp"
+
+namespace jsonpp::format
+{
+
+    namespace
+    {
+
+        // Output is handed to the sink in chunks of about this size.
+        constexpr std::size_t ChunkSize = 64 * 1024;
+
+        bool is_structural(char c)
+        {
+            return c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':' || c == '"';
+        }
+
+    }
+
+    void Formatter::feed(std::string_view chunk)
+    {
+        std::size_t i = 0;
+        while (i < chunk.size())
+        {
+            if (this->m_in_string)
+            {
+                // Copy the run of plain characters in one go.
+                auto start = i;
+                while (i < chunk.size() && (this->m_escape || (chunk[i] != '"' && chunk[i] != '\\')))
+                {
+                    this->m_escape = false;
+                    ++i;
+                }
+                this->m_out.append(chunk.substr(start, i - start));
+                if (i == chunk.size())
+                {
+                    break;
+                }
+
+                this->m_out.push_back(chunk[i]);
+                if (chunk[i] == '\\')
+                {
+                    this->m_escape = true;
+                }
+                else
+                {
+                    this->m_in_string = false;
+                }
+                ++i;
+                continue;
+            }
+
+            if (this->m_in_scalar)
+            {
+                // A number or literal, copied up to the next delimiter.
+                auto start = i;
+                while (i < chunk.size() && !lex::is_whitespace(chunk[i]) && !is_structural(chunk[i]))
+                {
+                    ++i;
+                }
+                this->m_out.append(chunk.substr(start, i - start));
+                this->m_in_scalar = i == chunk.size();
+                continue;
+            }
+
+            auto c = chunk[i];
+            if (lex::is_whitespace(c))
+            {
+                ++i;
+                continue;
+            }
+            if (this->m_done)
+            {
+                throw std::runtime_error("Unexpected data after the end of the JSON document");
+            }
+
+            switch (c)
+            {
+            case '{':
+            case '[':
+                this->before_value();
+                this->m_out.push_back(c);
+                this->m_stack.push_back(c == '{' ? Frame{'}', ExpectKeyOrEnd} : Frame{']', ExpectValueOrEnd});
+                this->m_pending_open = true;
+                break;
+            case '}':
+            case ']':
+            {
+                // Only where the container may end, so not after a comma or a key.
+                auto expect = this->m_stack.empty() ? ExpectValue : this->m_stack.back().expect;
+                if (this->m_stack.empty() || this->m_stack.back().close != c ||
+                    (expect != ExpectValueOrEnd && expect != ExpectKeyOrEnd && expect != ExpectCommaOrEnd))
+                {
+                    throw std::runtime_error(std::string("Unexpected '") + c + "' in JSON document");
+                }
+                this->m_stack.pop_back();
+                if (this->m_pending_open)
+                {
+                    this->m_pending_open = false;
+                }
+                else
+                {
+                    this->open_line(this->m_stack.size());
+                }
+                this->m_out.push_back(c);
+                this->m_done = this->m_stack.empty();
+                break;
+            }
+            case ',':
+                if (this->m_stack.empty() || this->m_stack.back().expect != ExpectCommaOrEnd)
+                {
+                    throw std::runtime_error("Unexpected ',' in JSON document");
+                }
+                this->m_stack.back().expect = this->m_stack.back().close == '}' ? ExpectKey : ExpectValue;
+                this->m_out.push_back(',');
+                this->open_line(this->m_stack.size());
+                break;
+            case ':':
+                if (this->m_stack.empty() || this->m_stack.back().expect != ExpectColon)
+                {
+                    throw std::runtime_error("Unexpected ':' in JSON document");
+                }
+                this->m_stack.back().expect = ExpectValue;
+                this->m_out.append(this->m_options.pretty ? ": " : ":");
+                break;
+            case '"':
+                if (!this->m_stack.empty() && (this->m_stack.back().expect == ExpectKeyOrEnd || this->m_stack.back().expect == ExpectKey))
+                {
+                    this->open_pending();
+                    this->m_stack.back().expect = ExpectColon;
+                }
+                else
+                {
+                    this->before_value();
+                    this->m_done = this->m_stack.empty();
+                }
+                this->m_out.push_back('"');
+                this->m_in_string = true;
+                break;
+            default:
+                this->before_value();
+                this->m_done = this->m_stack.empty();
+                this->m_in_scalar = true;
+                continue;
+            }
+            ++i;
+        }
+
+        this->flush(false);
+    }
+
+    void Formatter::finish()
+    {
+        if (this->m_in_string)
+        {
+            throw std::runtime_error("Unexpected end of input in JSON string");
+        }
+        if (!this->m_stack.empty() || !this->m_done)
+        {
+            throw std::runtime_error("Unexpected end of input in JSON document");
+        }
+        this->flush(true);
+    }
+
+    void Formatter::open_line(std::size_t depth)
+    {
+        if (!this->m_options.pretty)
+        {
+            return;
+        }
+
+        this->m_out.push_back('\n');
+        for (std::size_t i = 0; i < depth; ++i)
+        {
+            this->m_out.append(this->m_options.indent);
+        }
+    }
+
+    void Formatter::open_pending()
+    {
+        if (this->m_pending_open)
+        {
+            this->m_pending_open = false;
+            this->open_line(this->m_stack.size());
+        }
+    }
+
+    void Formatter::before_value()
+    {
+        if (!this->m_stack.empty())
+        {
+            auto &frame = this->m_stack.back();
+            switch (frame.expect)
+            {
+            case ExpectValueOrEnd:
+            case ExpectValue:
+                break;
+            case ExpectCommaOrEnd:
+                throw std::runtime_error("Expected comma");
+            case ExpectKeyOrEnd:
+            case ExpectKey:
+                throw std::runtime_error("Expected start of key");
+            case ExpectColon:
+                throw std::runtime_error("Expected colon");
+            }
+            frame.expect = ExpectCommaOrEnd;
+        }
+        this->open_pending();
+    }
+
+    void Formatter::flush(bool all)
+    {
+        if (all || this->m_out.size() >= ChunkSize)
+        {
+            this->m_sink(this->m_out);
+            this->m_out.clear();
+        }
+    }
+
+    static std::string reformat(std::string_view json_str, FormatOptions options)
+    {
+        auto out = std::string();
+        out.reserve(json_str.size());
+
+        auto formatter = Formatter(std::move(options), [&out](std::string_view chunk)
+                                   { out.append(chunk); });
+        formatter.feed(json_str);
+        formatter.finish();
+        return out;
+    }
+
+    std::string minify(std::string_view json_str)
+    {
+        return reformat(json_str, FormatOptions{false, ""});
+    }
+
+    std::string pretty(std::string_view json_str, std::string indent)
+    {
+        return reformat(json_str, FormatOptions{true, std::move(indent)});
+    }
+
+}
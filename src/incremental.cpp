@@ -0,0 +1,251 @@
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "lexer.hpp"
+#include "scanner.hpp"
+
+namespace jsonpp::incremental
+{
+
+    namespace
+    {
+
+        using Span = Document::Span;
+
+        /**
+         * A container that is still being read.
+         */
+        struct Frame
+        {
+            Span span;
+            bool object;
+            JsonObject members;
+            JsonArray elements;
+            std::string key;
+        };
+
+        JsonValue scalar(const scan::Token &token)
+        {
+            switch (token.type)
+            {
+            case scan::String:
+                return JsonValue(std::string(token.text));
+            case scan::Number:
+                return JsonValue(lex::to_double(token.text));
+            default:
+                return token.text == "null" ? JsonValue(nullptr) : JsonValue(token.text == "true");
+            }
+        }
+
+        /**
+         * Adds a finished value to the innermost open container, or makes it the result.
+         *
+         * @param span the span of the value if it is a container.
+         */
+        void attach(std::vector<Frame> &stack, JsonValue value, std::optional<Span> span, std::optional<JsonValue> &result, Span &root)
+        {
+            if (stack.empty())
+            {
+                result = std::move(value);
+                if (span)
+                {
+                    root = std::move(span.value());
+                }
+                return;
+            }
+
+            auto &parent = stack.back();
+            if (span)
+            {
+                span->offset -= parent.span.offset;
+            }
+            if (parent.object)
+            {
+                // Like JsonValue::parse the first of duplicate members is kept, and later ones get no
+                // span so edits inside them re-parse the whole object.
+                auto inserted = parent.members.insert({parent.key, std::move(value)}).second;
+                if (span && inserted)
+                {
+                    span->key = std::move(parent.key);
+                    parent.span.children.push_back(std::move(span.value()));
+                }
+            }
+            else
+            {
+                if (span)
+                {
+                    span->index = parent.elements.size();
+                    parent.span.children.push_back(std::move(span.value()));
+                }
+                parent.elements.push_back(std::move(value));
+            }
+        }
+
+        /**
+         * Parses text and records the span of every container in it.
+         *
+         * @param root set to the span of the value if it is a container. Its offset is relative to
+         * the start of text.
+         */
+        JsonValue build(std::string_view text, Span &root)
+        {
+            root = Span{0, 0, std::string(), 0, {}};
+            auto tokenizer = scan::Tokenizer(text);
+            auto stack = std::vector<Frame>();
+            auto result = std::optional<JsonValue>();
+            while (1)
+            {
+                auto token = tokenizer.next();
+                switch (token.type)
+                {
+                case scan::BeginObject:
+                case scan::BeginArray:
+                    stack.push_back(Frame{Span{token.offset, 0, std::string(), 0, {}}, token.type == scan::BeginObject, {}, {}, std::string()});
+                    break;
+                case scan::EndObject:
+                case scan::EndArray:
+                {
+                    auto frame = std::move(stack.back());
+                    stack.pop_back();
+                    frame.span.length = tokenizer.position() - frame.span.offset;
+                    auto value = frame.object ? JsonValue(std::move(frame.members)) : JsonValue(std::move(frame.elements));
+                    attach(stack, std::move(value), std::move(frame.span), result, root);
+                    break;
+                }
+                case scan::Key:
+                    stack.back().key = std::string(token.text);
+                    break;
+                case scan::String:
+                case scan::Number:
+                case scan::Literal:
+                    attach(stack, scalar(token), std::nullopt, result, root);
+                    break;
+                case scan::End:
+                    return std::move(result.value());
+                }
+            }
+        }
+
+        /**
+         * Walks from value to the descendant that the spans in path lead to, making every node on the
+         * way unique so it can be replaced.
+         */
+        JsonValue &descend(JsonValue &value, const std::vector<Span *> &path)
+        {
+            auto current = &value;
+            for (std::size_t i = 1; i < path.size(); ++i)
+            {
+                auto &inner = current->mutable_value()->get();
+                if (auto object = std::get_if<JsonObject>(&inner))
+                {
+                    current = &object->at(path[i]->key);
+                }
+                else
+                {
+                    current = &std::get<JsonArray>(inner)[path[i]->index];
+                }
+            }
+            return *current;
+        }
+
+    }
+
+    Document Document::parse(std::string text)
+    {
+        auto root = Span();
+        auto value = build(text, root);
+        auto size = text.size();
+        return Document(std::move(text), std::move(value), std::move(root), size);
+    }
+
+    void Document::edit(std::size_t offset, std::size_t length, std::string_view replacement)
+    {
+        if (offset > this->m_text.size() || length > this->m_text.size() - offset)
+        {
+            throw std::runtime_error("Edit is out of range of the JSON document");
+        }
+
+        auto text = this->m_text;
+        text.replace(offset, length, replacement);
+
+        // Find the smallest container whose brackets both lie outside of the edit.
+        auto path = std::vector<Span *>();
+        auto begin = this->m_root.offset;
+        auto inside = [&](const Span &span, std::size_t start)
+        {
+            return span.length > 0 && start < offset && offset + length < start + span.length;
+        };
+        if (inside(this->m_root, begin))
+        {
+            path.push_back(&this->m_root);
+            while (1)
+            {
+                auto &children = path.back()->children;
+                auto it = std::upper_bound(children.begin(), children.end(), offset - begin, [](std::size_t position, const Span &child)
+                                           { return position < child.offset; });
+                if (it == children.begin() || !inside(*(it - 1), begin + (it - 1)->offset))
+                {
+                    break;
+                }
+                begin += (it - 1)->offset;
+                path.push_back(&*(it - 1));
+            }
+        }
+
+        if (!path.empty())
+        {
+            auto target = path.back();
+            auto new_length = target->length + replacement.size() - length;
+            auto span = Span();
+            auto fragment = std::optional<JsonValue>();
+            try
+            {
+                fragment = build(std::string_view(text).substr(begin, new_length), span);
+            }
+            catch (const std::runtime_error &)
+            {
+                // The edit changed structure beyond the container, e.g. by closing it early.
+            }
+
+            if (fragment)
+            {
+                auto value = this->m_value;
+                descend(value, path) = std::move(fragment.value());
+
+                // Nothing can throw from here on.
+                for (std::size_t i = 0; i + 1 < path.size(); ++i)
+                {
+                    path[i]->length += replacement.size() - length;
+                    for (auto &sibling : path[i]->children)
+                    {
+                        if (sibling.offset > path[i + 1]->offset)
+                        {
+                            sibling.offset += replacement.size() - length;
+                        }
+                    }
+                }
+                span.offset = target->offset;
+                span.key = std::move(target->key);
+                span.index = target->index;
+                *target = std::move(span);
+
+                this->m_text = std::move(text);
+                this->m_value = std::move(value);
+                this->m_parsed_bytes = new_length;
+                return;
+            }
+        }
+
+        auto root = Span();
+        auto value = build(text, root);
+        this->m_parsed_bytes = text.size();
+        this->m_text = std::move(text);
+        this->m_value = std::move(value);
+        this->m_root = std::move(root);
+    }
+
+}
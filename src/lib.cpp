@@ -1,41 +1,40 @@
 #include "lib.hpp"
 
 #include <variant>
+#include <deque>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <optional>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
 #include <stdexcept>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <iterator>
+#include <functional>
 
 #include "utils.hpp"
+#include "lexer.hpp"
 #include "state.hpp"
 #include "pda.hpp"
+#include "query.hpp"
+#include "schema.hpp"
+#include "serialize.hpp"
 
 namespace jsonpp
 {
 
     std::string ToJsonVisitor::operator()(const JsonObject &o) const
     {
-        auto strs = std::vector<std::string>();
-        strs.reserve(o.size());
-
-        std::transform(o.begin(), o.end(), std::back_inserter(strs), [](auto kv)
-                       { return kv.first + ":" + kv.second.json(); });
-
-        return "{" + utils::join(strs, ',') + "}";
+        return JsonValue(o).json();
     }
 
     std::string ToJsonVisitor::operator()(const JsonArray &a) const
     {
-        auto strs = std::vector<std::string>();
-        strs.reserve(a.size());
-
-        std::transform(a.begin(), a.end(), std::back_inserter(strs), [](auto elem)
-                       { return elem.json(); });
-
-        return "[" + utils::join(strs, ',') + "]";
+        return JsonValue(a).json();
     }
 
     std::string ToJsonVisitor::operator()(const std::string &s) const
@@ -45,12 +44,130 @@ namespace jsonpp
 
     std::string ToJsonVisitor::operator()(const double &d) const
     {
-        return std::to_string(d);
+        // JSON has no representation for infinities and NaN.
+        if (!std::isfinite(d))
+        {
+            return "null";
+        }
+
+        // Shortest representation that parses back to the same double.
+        char buffer[32];
+        auto res = std::to_chars(buffer, buffer + sizeof(buffer), d);
+        return std::string(buffer, res.ptr);
     }
 
     std::string ToJsonVisitor::operator()(const bool &b) const
     {
-        return std::to_string(b);
+        return b ? "true" : "false";
+    }
+
+    std::string ToJsonVisitor::operator()(const JsonRaw &r) const
+    {
+        return r.text;
+    }
+
+    std::string ToJsonVisitor::operator()(const JsonNumberArray &a) const
+    {
+        auto out = std::string("[");
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (i > 0)
+            {
+                out.push_back(',');
+            }
+            out.append((*this)(a[i]));
+        }
+        out.push_back(']');
+        return out;
+    }
+
+    // json() appends every chunk to its result, so the buffer only needs to amortize the sink calls.
+    static constexpr std::size_t JsonBufferSize = 4096;
+
+    std::string JsonValue::json() const
+    {
+        if (!this->m_value)
+        {
+            return "null";
+        }
+
+        const auto &value = this->m_value->value;
+        if (!std::holds_alternative<JsonObject>(value) && !std::holds_alternative<JsonArray>(value))
+        {
+            return std::visit(ToJsonVisitor{}, value);
+        }
+
+        auto out = std::string();
+        auto serializer = serialize::Serializer(
+            *this,
+            [&out](std::string_view chunk)
+            {
+                out.append(chunk);
+                return chunk.size();
+            },
+            JsonBufferSize);
+        serializer.write();
+        return out;
+    }
+
+    // Plain recursion is the cheapest way to free a tree, and this many levels of it fit on any stack.
+    static constexpr std::size_t MaxRecursiveFree = 256;
+
+    void JsonValue::Node::free_children()
+    {
+        static thread_local std::size_t depth = 0;
+        if (depth < MaxRecursiveFree)
+        {
+            // Frees the children while counted, so the nodes below see one more level.
+            ++depth;
+            this->value.emplace<bool>(false);
+            --depth;
+            return;
+        }
+
+        // Below that, children that only this tree owns are detached before they are released, so
+        // each node is freed with nothing left below it. Scalars and shared children are released in
+        // place.
+        auto pending = std::vector<std::shared_ptr<Node>>();
+        auto detach = [&pending](JsonValueVariant &value)
+        {
+            auto take = [&pending](JsonValue &child)
+            {
+                if (!child.m_value || child.m_value.use_count() != 1)
+                {
+                    return;
+                }
+                const auto &inner = child.m_value->value;
+                auto object = std::get_if<JsonObject>(&inner);
+                auto array = std::get_if<JsonArray>(&inner);
+                if ((object && !object->empty()) || (array && !array->empty()))
+                {
+                    pending.push_back(std::move(child.m_value));
+                }
+            };
+            if (auto object = std::get_if<JsonObject>(&value))
+            {
+                for (auto &member : *object)
+                {
+                    take(member.second);
+                }
+            }
+            else if (auto array = std::get_if<JsonArray>(&value))
+            {
+                for (auto &element : *array)
+                {
+                    take(element);
+                }
+            }
+        };
+
+        detach(this->value);
+        while (!pending.empty())
+        {
+            auto node = std::move(pending.back());
+            pending.pop_back();
+            detach(node->value);
+        }
     }
 
     template <std::size_t I, typename... Ts>
@@ -85,7 +202,7 @@ namespace jsonpp
 
     pda::StateOp<State> StateValue::transition(const char c)
     {
-        if (std::isspace(c))
+        if (lex::is_whitespace(c))
         {
             return pda::Noop{};
         }
@@ -95,6 +212,11 @@ namespace jsonpp
             return pda::Pop{};
         }
 
+        if (this->raw)
+        {
+            return pda::Push<State>{StateRaw{}, true};
+        }
+
         if (auto new_state = tryCreateState<
                 StateString, StateNumber, StateExact<True>, StateExact<False>, StateExact<Null>, StateObject, StateArray>(c))
         {
@@ -108,39 +230,24 @@ namespace jsonpp
         throw std::runtime_error("Invalid JSON value");
     }
 
-    StateFinalizationResult StateValue::finalize() const
+    StateFinalizationResult StateValue::finalize() const &
+    {
+        return StateValue(*this).finalize();
+    }
+
+    StateFinalizationResult StateValue::finalize() &&
     {
         if (!m_value.has_value())
         {
             return std::string("Unexpected end of input in JSON value");
         }
-        return m_value.value();
+        return std::move(m_value.value());
     }
 
     std::optional<StateNumber> StateNumber::create_if_valid_start(char c)
     {
-        StateNumberState state;
-        if (c == '.')
-        {
-            state = StateNumberState::Dot;
-        }
-        else if (c == 'e' || c == 'E')
-        {
-            state = StateNumberState::Exp;
-        }
-        else if (c == '0')
-        {
-            state = StateNumberState::Zero;
-        }
-        else if (std::isdigit(c))
-        {
-            state = StateNumberState::SomeDigits;
-        }
-        else if (c == '-')
-        {
-            state = StateNumberState::NoDigits;
-        }
-        else
+        auto state = lex::next_number_state(lex::NumberStart, c);
+        if (state == lex::NumberInvalid)
         {
             return std::nullopt;
         }
@@ -150,135 +257,28 @@ namespace jsonpp
 
     pda::StateOp<State> StateNumber::transition(const char c)
     {
-        switch (this->state)
+        auto next = lex::next_number_state(this->state, c);
+        if (next == lex::NumberEnd)
         {
-        case NoDigits:
-            if (c == '0')
-            {
-                this->state = Zero;
-            }
-            else if (std::isdigit(c))
-            {
-                this->state = SomeDigits;
-            }
-            else
-            {
-                throw std::runtime_error("Invalid character");
-            }
-            this->s.push_back(c);
-            break;
-        case SomeDigits:
-            if (std::isdigit(c))
-            {
-            }
-            else if (c == '.')
-            {
-                this->state = Dot;
-            }
-            else if (c == 'e' || c == 'E')
-            {
-                this->state = Exp;
-            }
-            else
-            {
-                return pda::Pop{};
-            }
-            this->s.push_back(c);
-            break;
-        case Zero:
-            if (c == '.')
-            {
-                this->state = Dot;
-            }
-            else if (c == 'e' || c == 'E')
-            {
-                this->state = Exp;
-            }
-            else
-            {
-                return pda::Pop{};
-            }
-            this->s.push_back(c);
-            break;
-        case Dot:
-            if (std::isdigit(c))
-            {
-                this->state = DotDigits;
-            }
-            else
-            {
-                throw std::runtime_error("Invalid character");
-            }
-            this->s.push_back(c);
-            break;
-        case DotDigits:
-            if (std::isdigit(c))
-            {
-            }
-            else if (c == 'e' || c == 'E')
-            {
-                this->state = Exp;
-            }
-            else
-            {
-                return pda::Pop{};
-            }
-            this->s.push_back(c);
-            break;
-        case Exp:
-            if (std::isdigit(c))
-            {
-                this->state = ExpDigits;
-            }
-            else if (c == 'e' || c == 'E')
-            {
-                this->state = ExpSign;
-            }
-            else
-            {
-                throw std::runtime_error("Invalid character");
-            }
-            this->s.push_back(c);
-            break;
-        case ExpSign:
-            if (std::isdigit(c))
-            {
-                this->state = ExpDigits;
-            }
-            else
-            {
-                throw std::runtime_error("Invalid character");
-            }
-            this->s.push_back(c);
-            break;
-        case ExpDigits:
-            if (std::isdigit(c))
-            {
-                this->state = ExpDigits;
-            }
-            else
-            {
-                return pda::Pop{};
-            }
-            this->s.push_back(c);
-            break;
+            return pda::Pop{};
+        }
+        if (next == lex::NumberInvalid)
+        {
+            throw std::runtime_error("Invalid character");
         }
 
+        this->state = next;
+        this->s.push_back(c);
         return pda::Noop{};
     }
 
     StateFinalizationResult StateNumber::finalize() const
     {
-        switch (this->state)
+        if (!lex::number_accepting(this->state))
         {
-        case Zero:
-        case SomeDigits:
-        case DotDigits:
-        case ExpDigits:
-            return std::strtod(this->s.c_str(), NULL);
-        default:
             return std::string("Unexpected end of input in JSON number");
         }
+        return lex::to_double(this->s);
     }
 
     template <StateExactType ExactType>
@@ -294,7 +294,7 @@ namespace jsonpp
     template <StateExactType ExactType>
     pda::StateOp<State> StateExact<ExactType>::transition(const char c)
     {
-        if (this->matched >= strlen(this->match()))
+        if (this->matched == length())
         {
             return pda::Pop{};
         }
@@ -312,7 +312,7 @@ namespace jsonpp
     template <StateExactType ExactType>
     StateFinalizationResult StateExact<ExactType>::finalize() const
     {
-        if (this->matched != strlen(this->match()))
+        if (this->matched != length())
         {
             return std::string("Unexpected end of input in JSON ") + this->match();
         }
@@ -342,33 +342,31 @@ namespace jsonpp
 
     pda::StateOp<State> StateString::transition(const char c)
     {
-        if (this->s.back() == '\\')
+        if (this->hex_digits > 0)
         {
-            if (!(c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't' || c == 'u'))
+            if (!lex::is_hex(c))
             {
-                throw std::runtime_error("Invalid escape sequence in JSON string");
+                throw std::runtime_error("Invalid hex digit in unicode escaped sequence in JSON string");
             }
+            --this->hex_digits;
         }
-        else
+        else if (this->escaped)
         {
-            auto start_pos = this->s.size() - 6;
-            if (start_pos < 0)
-            {
-                start_pos = 0;
-            }
-            auto unicode_escaoe = this->s.find("\\u", start_pos);
-            if (unicode_escaoe != std::string::npos && unicode_escaoe >= this->s.size() - 6)
-            {
-                if (!std::isxdigit(c))
-                {
-                    throw std::runtime_error("Invalid hex digit in unicode escaped sequence in JSON string");
-                }
-            }
-            else if (c == '"')
+            if (!lex::is_escape(c))
             {
-                this->finished = true;
-                return pda::Pop{false};
+                throw std::runtime_error("Invalid escape sequence in JSON string");
             }
+            this->escaped = false;
+            this->hex_digits = c == 'u' ? 4 : 0;
+        }
+        else if (c == '\\')
+        {
+            this->escaped = true;
+        }
+        else if (c == '"')
+        {
+            this->finished = true;
+            return pda::Pop{false};
         }
 
         this->s.push_back(c);
@@ -376,13 +374,18 @@ namespace jsonpp
         return pda::Noop{};
     }
 
-    StateFinalizationResult StateString::finalize() const
+    StateFinalizationResult StateString::finalize() const &
+    {
+        return StateString(*this).finalize();
+    }
+
+    StateFinalizationResult StateString::finalize() &&
     {
         if (!this->finished)
         {
             return std::string("Missing closing \" on JSON string");
         }
-        return JsonValue(this->s);
+        return JsonValue(std::move(this->s));
     }
 
     std::optional<StateArray> StateArray::create_if_valid_start(char c)
@@ -396,12 +399,32 @@ namespace jsonpp
 
     pda::StateOp<State> StateArray::transition(const char c)
     {
-        if (std::isspace(c))
+        if (this->number_state != lex::NumberStart)
+        {
+            auto next = lex::next_number_state(this->number_state, c);
+            if (next == lex::NumberInvalid)
+            {
+                throw std::runtime_error("Invalid character");
+            }
+            if (next != lex::NumberEnd)
+            {
+                this->number_state = next;
+                this->digits.push_back(c);
+                return pda::Noop{};
+            }
+            this->end_number();
+        }
+
+        if (lex::is_whitespace(c))
         {
             return pda::Noop{};
         }
         else if (c == ']')
         {
+            if (!this->need_comma && (!this->values.empty() || !this->numbers.empty()))
+            {
+                throw std::runtime_error("Trailing comma in JSON array");
+            }
             this->finished = true;
             return pda::Pop{false};
         }
@@ -414,19 +437,59 @@ namespace jsonpp
             this->need_comma = false;
             return pda::Noop{};
         }
+        else if (this->pack)
+        {
+            auto next = lex::next_number_state(lex::NumberStart, c);
+            if (next != lex::NumberInvalid)
+            {
+                this->number_state = next;
+                this->digits.push_back(c);
+                return pda::Noop{};
+            }
+            this->unpack();
+            return pda::Push<State>{StateValue{}, true};
+        }
         else
         {
             return pda::Push<State>{StateValue{}, true};
         }
     }
 
-    StateFinalizationResult StateArray::finalize() const
+    void StateArray::end_number()
+    {
+        this->numbers.push_back(lex::to_double(this->digits));
+        this->digits.clear();
+        this->number_state = lex::NumberStart;
+        this->need_comma = true;
+    }
+
+    void StateArray::unpack()
+    {
+        this->values.reserve(this->numbers.size() + 1);
+        for (auto d : this->numbers)
+        {
+            this->values.push_back(JsonValue(d));
+        }
+        this->numbers = JsonNumberArray();
+        this->pack = false;
+    }
+
+    StateFinalizationResult StateArray::finalize() const &
+    {
+        return StateArray(*this).finalize();
+    }
+
+    StateFinalizationResult StateArray::finalize() &&
     {
         if (!this->finished)
         {
             return std::string("Missing closing ] on JSON array");
         }
-        return JsonValue(this->values);
+        if (!this->numbers.empty())
+        {
+            return JsonValue(std::move(this->numbers));
+        }
+        return JsonValue(std::move(this->values));
     }
 
     std::optional<StateObject> StateObject::create_if_valid_start(char c)
@@ -440,7 +503,7 @@ namespace jsonpp
 
     pda::StateOp<State> StateObject::transition(const char c)
     {
-        if (std::isspace(c))
+        if (lex::is_whitespace(c))
         {
             return pda::Noop{};
         }
@@ -450,6 +513,10 @@ namespace jsonpp
             {
                 throw std::runtime_error("JSON object missing value after key");
             }
+            if (!this->need_comma && !this->values.empty())
+            {
+                throw std::runtime_error("Trailing comma in JSON object");
+            }
             this->finished = true;
             return pda::Pop{false};
         }
@@ -481,64 +548,279 @@ namespace jsonpp
         }
     }
 
-    StateFinalizationResult StateObject::finalize() const
+    StateFinalizationResult StateObject::finalize() const &
+    {
+        return StateObject(*this).finalize();
+    }
+
+    StateFinalizationResult StateObject::finalize() &&
     {
         if (!this->finished)
         {
             return std::string("Missing closing } on JSON object");
         }
-        return JsonValue(this->values);
+        return JsonValue(std::move(this->values));
     }
 
-    struct StatePopOpVisitor
+    pda::StateOp<State> StateRaw::transition(const char c)
     {
-        template <typename TCallback>
-        std::optional<pda::Reject> tryFinalizePopped(TCallback callback)
+        switch (this->scalar)
         {
-            auto res = std::visit(
-                [](auto &state)
+        case KeyScalar:
+        case StringScalar:
+            this->text.push_back(c);
+            if (this->hex_digits > 0)
+            {
+                if (!lex::is_hex(c))
                 {
-                    return state.finalize();
-                },
-                this->popped);
-            auto error = std::get_if<std::string>(&res);
-            if (error)
+                    throw std::runtime_error("Invalid hex digit in unicode escaped sequence in JSON string");
+                }
+                --this->hex_digits;
+            }
+            else if (this->escaped)
             {
-                return pda::Reject{*error};
+                if (!lex::is_escape(c))
+                {
+                    throw std::runtime_error("Invalid escape sequence in JSON string");
+                }
+                this->escaped = false;
+                this->hex_digits = c == 'u' ? 4 : 0;
             }
-            auto value = std::get<JsonValue>(res);
-            return callback(value);
+            else if (c == '\\')
+            {
+                this->escaped = true;
+            }
+            else if (c == '"')
+            {
+                if (this->scalar == KeyScalar)
+                {
+                    this->scalar = NoScalar;
+                    this->expect = ExpectColon;
+                    return pda::Noop{};
+                }
+                return this->end_value();
+            }
+            ++this->length;
+            return pda::Noop{};
+        case NumberScalar:
+        {
+            auto next = lex::next_number_state(this->number, c);
+            if (next == lex::NumberInvalid)
+            {
+                throw std::runtime_error("Invalid character");
+            }
+            if (next != lex::NumberEnd)
+            {
+                this->number = next;
+                this->text.push_back(c);
+                return pda::Noop{};
+            }
+            if (this->closers.empty())
+            {
+                // A number is only known to end at the byte after it, which belongs to the parent.
+                // scalar is left alone so the SourceMap can tell.
+                this->finished = true;
+                return pda::Pop{};
+            }
+            this->end_value();
+            break;
+        }
+        case LiteralScalar:
+            if (c != this->literal.front())
+            {
+                throw std::runtime_error(std::string("Expected '") + this->literal.front() + std::string("' but got '") + c + std::string("'"));
+            }
+            this->text.push_back(c);
+            this->literal.remove_prefix(1);
+            return this->literal.empty() ? this->end_value() : pda::Noop{};
+        case NoScalar:
+            break;
         }
 
-        std::optional<pda::Reject> operator()(StateValue &state)
+        if (lex::is_whitespace(c))
         {
-            return this->tryFinalizePopped(
-                [&](auto value)
-                {
-                    state.m_value = value;
-                    return std::nullopt;
-                });
+            this->text.push_back(c);
+            return pda::Noop{};
         }
 
-        std::optional<pda::Reject> operator()(StateArray &state)
+        switch (this->expect)
         {
-            return this->tryFinalizePopped(
-                [&](auto value)
-                {
-                    state.values.push_back(value);
-                    state.need_comma = true;
-                    return std::nullopt;
-                });
+        case ExpectValueOrEnd:
+        case ExpectCommaOrEnd:
+        case ExpectKeyOrEnd:
+            if (c == this->closers.back())
+            {
+                this->text.push_back(c);
+                this->closers.pop_back();
+                this->elements.pop_back();
+                return this->end_value();
+            }
+            break;
+        default:
+            break;
         }
 
-        std::optional<pda::Reject> operator()(StateObject &state)
+        switch (this->expect)
+        {
+        case ExpectValue:
+        case ExpectValueOrEnd:
+            return this->start_value(c);
+        case ExpectCommaOrEnd:
+            if (c != ',')
+            {
+                throw std::runtime_error("Expected comma");
+            }
+            this->expect = this->closers.back() == '}' ? ExpectKey : ExpectValue;
+            break;
+        case ExpectKey:
+        case ExpectKeyOrEnd:
+            if (c != '"')
+            {
+                throw std::runtime_error("Expected start of key");
+            }
+            this->scalar = KeyScalar;
+            this->length = 0;
+            ++this->elements.back();
+            break;
+        case ExpectColon:
+            if (c != ':')
+            {
+                throw std::runtime_error("Expected colon");
+            }
+            this->expect = ExpectValue;
+            break;
+        }
+        this->text.push_back(c);
+        return pda::Noop{};
+    }
+
+    pda::StateOp<State> StateRaw::start_value(const char c)
+    {
+        // Members are counted at their key.
+        if (!this->closers.empty() && this->closers.back() == ']')
+        {
+            ++this->elements.back();
+        }
+
+        switch (c)
+        {
+        case '{':
+            this->closers.push_back('}');
+            this->elements.push_back(0);
+            this->expect = ExpectKeyOrEnd;
+            break;
+        case '[':
+            this->closers.push_back(']');
+            this->elements.push_back(0);
+            this->expect = ExpectValueOrEnd;
+            break;
+        case '"':
+            this->scalar = StringScalar;
+            this->length = 0;
+            break;
+        case 't':
+            this->scalar = LiteralScalar;
+            this->literal = std::string_view(StateExact<True>::match()).substr(1);
+            break;
+        case 'f':
+            this->scalar = LiteralScalar;
+            this->literal = std::string_view(StateExact<False>::match()).substr(1);
+            break;
+        case 'n':
+            this->scalar = LiteralScalar;
+            this->literal = std::string_view(StateExact<Null>::match()).substr(1);
+            break;
+        default:
+            this->number = lex::next_number_state(lex::NumberStart, c);
+            if (this->number == lex::NumberInvalid)
+            {
+                throw std::runtime_error("Invalid JSON value");
+            }
+            this->scalar = NumberScalar;
+            break;
+        }
+        this->text.push_back(c);
+        return pda::Noop{};
+    }
+
+    pda::StateOp<State> StateRaw::end_value()
+    {
+        this->scalar = NoScalar;
+        if (this->closers.empty())
+        {
+            this->finished = true;
+            return pda::Pop{false};
+        }
+        this->expect = ExpectCommaOrEnd;
+        return pda::Noop{};
+    }
+
+    StateFinalizationResult StateRaw::finalize() const &
+    {
+        return StateRaw(*this).finalize();
+    }
+
+    StateFinalizationResult StateRaw::finalize() &&
+    {
+        auto number = this->scalar == NumberScalar && this->closers.empty() && lex::number_accepting(this->number);
+        if (!this->finished && !number)
+        {
+            return std::string("Unexpected end of input in JSON value");
+        }
+        return JsonValue(JsonRaw{std::move(this->text)});
+    }
+
+    struct StatePopOpVisitor
+    {
+        template <typename TCallback>
+        std::optional<pda::Reject> tryFinalizePopped(TCallback callback)
+        {
+            // Popped states are never used again, so their contents are moved into the parent rather
+            // than copied. Copying made every pop cost as much as the subtree below it.
+            auto res = std::visit(
+                [](auto &state)
+                {
+                    return std::move(state).finalize();
+                },
+                this->popped);
+            auto error = std::get_if<std::string>(&res);
+            if (error)
+            {
+                return pda::Reject{*error};
+            }
+            auto value = std::get<JsonValue>(std::move(res));
+            return callback(value);
+        }
+
+        std::optional<pda::Reject> operator()(StateValue &state)
         {
             return this->tryFinalizePopped(
-                [&](auto value)
+                [&](JsonValue &value)
+                {
+                    state.m_value = std::move(value);
+                    return std::nullopt;
+                });
+        }
+
+        std::optional<pda::Reject> operator()(StateArray &state)
+        {
+            return this->tryFinalizePopped(
+                [&](JsonValue &value)
+                {
+                    state.values.push_back(std::move(value));
+                    state.need_comma = true;
+                    return std::nullopt;
+                });
+        }
+
+        std::optional<pda::Reject> operator()(StateObject &state)
+        {
+            return this->tryFinalizePopped(
+                [&](JsonValue &value) -> std::optional<pda::Reject>
                 {
                     if (state.current_key)
                     {
-                        state.values.insert({state.current_key.value(), value});
+                        state.values.insert({std::move(state.current_key.value()), std::move(value)});
                         state.current_key = std::nullopt;
                         state.need_comma = true;
                     }
@@ -560,28 +842,510 @@ namespace jsonpp
         State popped;
     };
 
-    JsonValue JsonValue::parse(const std::string_view json_str)
+#ifdef JSONPP_INSTRUMENTATION
+    /**
+     * Copies the automaton counters into the caller's stats when parsing ends, including when it
+     * ends with an exception.
+     */
+    struct StatsRecorder
     {
-        auto it = json_str.begin();
-        auto pda = pda::PushdownAutomata<State, char>(StateValue{});
+        ~StatsRecorder()
+        {
+            this->record();
+        }
 
-        for (size_t i = 0; i < json_str.size(); ++i)
+        void record()
         {
-            auto c = json_str[i];
-            auto res = pda.transition(
+            if (this->stats)
+            {
+                this->stats->transitions = this->counters.transitions;
+                this->stats->pushes = this->counters.pushes;
+                this->stats->pops = this->counters.pops;
+                this->stats->max_depth = this->counters.max_depth;
+            }
+        }
+
+        ParseStats *stats;
+        pda::Counters counters;
+    };
+
+    /**
+     * Adds the time between construction and destruction to the counter for the kind of state.
+     */
+    class StateTimer
+    {
+    public:
+        StateTimer(ParseStats *stats, const State &state) : m_time(nullptr)
+        {
+            if (!stats)
+            {
+                return;
+            }
+            this->m_time = &std::visit(
+                utils::inline_visitor{
+                    [stats](const StateValue &) -> std::chrono::nanoseconds &
+                    { return stats->value_time; },
+                    [stats](const StateNumber &) -> std::chrono::nanoseconds &
+                    { return stats->number_time; },
+                    [stats](const StateString &) -> std::chrono::nanoseconds &
+                    { return stats->string_time; },
+                    [stats](const StateArray &) -> std::chrono::nanoseconds &
+                    { return stats->array_time; },
+                    [stats](const StateObject &) -> std::chrono::nanoseconds &
+                    { return stats->object_time; },
+                    [stats](const auto &) -> std::chrono::nanoseconds &
+                    { return stats->literal_time; },
+                },
+                state);
+            this->m_start = std::chrono::steady_clock::now();
+        }
+
+        ~StateTimer()
+        {
+            if (this->m_time)
+            {
+                *this->m_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->m_start);
+            }
+        }
+
+    private:
+        std::chrono::nanoseconds *m_time;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    /**
+     * Counts the heap bytes held by the scratch buffer of a popped string or number.
+     */
+    static void count_scratch(ParseStats *stats, const State &popped)
+    {
+        if (!stats)
+        {
+            return;
+        }
+
+        auto heap_bytes = [](const std::string &s)
+        {
+            return s.capacity() > std::string().capacity() ? s.capacity() : 0;
+        };
+        if (auto string = std::get_if<StateString>(&popped))
+        {
+            stats->string_bytes += heap_bytes(string->s);
+        }
+        else if (auto number = std::get_if<StateNumber>(&popped))
+        {
+            stats->number_bytes += heap_bytes(number->s);
+        }
+        else if (auto array = std::get_if<StateArray>(&popped))
+        {
+            stats->number_bytes += heap_bytes(array->digits);
+        }
+    }
+#endif
+
+    /**
+     * Enforces the limits in ParseOptions as the automaton runs. Every check is a comparison against
+     * a counter that is kept up to date on pushes, pops and string bytes.
+     */
+    class LimitChecker
+    {
+    public:
+        explicit LimitChecker(const ParseOptions &options) : m_options(options) {}
+
+        void check_document(std::size_t size) const
+        {
+            if (size > this->m_options.max_document_size)
+            {
+                throw std::runtime_error("JSON document exceeds the maximum size");
+            }
+        }
+
+        void check_transition(const State &state, const pda::StateOp<State> &op)
+        {
+            if (auto raw = std::get_if<StateRaw>(&state))
+            {
+                if (this->m_depth + raw->closers.size() > this->m_options.max_depth)
+                {
+                    throw std::runtime_error("JSON exceeds the maximum nesting depth");
+                }
+                if ((raw->scalar == StateRaw::KeyScalar || raw->scalar == StateRaw::StringScalar) && raw->length > this->m_options.max_string_length)
+                {
+                    throw std::runtime_error("JSON string exceeds the maximum length");
+                }
+                if (!raw->elements.empty() && raw->elements.back() > this->m_options.max_elements)
+                {
+                    throw std::runtime_error(raw->closers.back() == '}' ? "JSON object exceeds the maximum number of members" : "JSON array exceeds the maximum number of elements");
+                }
+                this->allocate(1);
+            }
+            else if (auto string = std::get_if<StateString>(&state))
+            {
+                if (std::holds_alternative<pda::Noop>(op))
+                {
+                    if (string->s.size() > this->m_options.max_string_length)
+                    {
+                        throw std::runtime_error("JSON string exceeds the maximum length");
+                    }
+                    this->allocate(1);
+                }
+            }
+            else if (auto array = std::get_if<StateArray>(&state))
+            {
+                if (array->numbers.size() > this->m_options.max_elements)
+                {
+                    throw std::runtime_error("JSON array exceeds the maximum number of elements");
+                }
+            }
+
+            if (auto push = std::get_if<pda::Push<State>>(&op))
+            {
+                if (std::holds_alternative<StateArray>(push->state) || std::holds_alternative<StateObject>(push->state))
+                {
+                    if (++this->m_depth > this->m_options.max_depth)
+                    {
+                        throw std::runtime_error("JSON exceeds the maximum nesting depth");
+                    }
+                }
+            }
+        }
+
+        void check_pop(const State &state, const State &popped)
+        {
+            if (std::holds_alternative<StateArray>(popped) || std::holds_alternative<StateObject>(popped))
+            {
+                --this->m_depth;
+            }
+            if (auto array = std::get_if<StateArray>(&popped))
+            {
+                this->allocate(array->numbers.capacity() * sizeof(double));
+            }
+
+            if (std::holds_alternative<StateValue>(state))
+            {
+                this->allocate(sizeof(JsonValue) + sizeof(JsonValueVariant));
+            }
+            else if (auto object = std::get_if<StateObject>(&state); object && !object->current_key)
+            {
+                this->allocate(sizeof(JsonObject::value_type));
+            }
+        }
+
+        void check_absorbed(const State &state) const
+        {
+            if (auto array = std::get_if<StateArray>(&state))
+            {
+                if (array->values.size() > this->m_options.max_elements)
+                {
+                    throw std::runtime_error("JSON array exceeds the maximum number of elements");
+                }
+            }
+            else if (auto object = std::get_if<StateObject>(&state))
+            {
+                if (object->values.size() > this->m_options.max_elements)
+                {
+                    throw std::runtime_error("JSON object exceeds the maximum number of members");
+                }
+            }
+        }
+
+    private:
+        void allocate(std::size_t bytes)
+        {
+            this->m_allocated += bytes;
+            if (this->m_allocated > this->m_options.max_allocation)
+            {
+                throw std::runtime_error("JSON document exceeds the allocation budget");
+            }
+        }
+
+        const ParseOptions &m_options;
+        std::size_t m_depth = 0;
+        std::size_t m_allocated = 0;
+    };
+
+    struct Parser::Impl
+    {
+        Impl(const ParseOptions &options, ParseStats *stats, SourceMap *source_map)
+            : options(options), limits(this->options), pda(StateValue{std::nullopt, root_raw(options)}), stats(stats), source_map(source_map)
+        {
+            this->raw = !options.raw_pointers.empty() || options.raw_depth != std::numeric_limits<std::size_t>::max();
+            if (this->raw)
+            {
+                auto candidates = std::vector<std::size_t>();
+                for (const auto &pointer : options.raw_pointers)
+                {
+                    auto parsed = JsonPointer::parse(pointer);
+                    auto tokens = std::vector<std::string>();
+                    for (const auto &segment : parsed.segments())
+                    {
+                        tokens.push_back(std::get<PathToken>(segment).token);
+                    }
+                    if (!tokens.empty())
+                    {
+                        candidates.push_back(this->raw_pointers.size());
+                    }
+                    this->raw_pointers.push_back(std::move(tokens));
+                }
+                this->raw_candidates.push_back(std::move(candidates));
+            }
+            if (options.schema)
+            {
+                this->validator.emplace(*options.schema);
+            }
+#ifdef JSONPP_INSTRUMENTATION
+            this->recorder.stats = stats;
+            this->pda.instrument(stats ? &this->recorder.counters : nullptr);
+#endif
+        }
+
+        ParseOptions options;
+        LimitChecker limits;
+        pda::PushdownAutomata<State, char> pda;
+        std::size_t size = 0;
+        bool finished = false;
+        ParseStats *stats;
+#ifdef JSONPP_INSTRUMENTATION
+        StatsRecorder recorder{nullptr, {}};
+#endif
+
+        /**
+         * A value starts at the byte where its StateValue pushes the state that reads it.
+         */
+        void record_start(const State &state, const pda::StateOp<State> &op, std::size_t position)
+        {
+            if (std::holds_alternative<StateValue>(state) && std::holds_alternative<pda::Push<State>>(op))
+            {
+                this->starts.push_back(position);
+            }
+        }
+
+        /**
+         * A value ends when that state is popped back into the StateValue: strings and containers are
+         * popped on their last byte, numbers and literals on the byte after them.
+         */
+        void record_end(const State &state, const State &popped, std::size_t position)
+        {
+            auto value = std::get_if<StateValue>(&state);
+            if (!value || std::holds_alternative<StateValue>(popped))
+            {
+                return;
+            }
+
+            auto last_byte = std::holds_alternative<StateString>(popped) || std::holds_alternative<StateArray>(popped) || std::holds_alternative<StateObject>(popped);
+            if (auto raw = std::get_if<StateRaw>(&popped))
+            {
+                // Like other numbers, a raw number is popped on the byte after it.
+                last_byte = raw->scalar != StateRaw::NumberScalar;
+            }
+            this->source_map->record(value->m_value.value(), SourceSpan{this->starts.back(), last_byte ? position + 1 : position});
+            this->starts.pop_back();
+        }
+
+        SourceMap *source_map;
+        // Start offsets of the values being read, innermost last.
+        std::vector<std::size_t> starts;
+
+        static bool root_raw(const ParseOptions &options)
+        {
+            return options.raw_depth == 0 || std::find(options.raw_pointers.begin(), options.raw_pointers.end(), "") != options.raw_pointers.end();
+        }
+
+        /**
+         * Marks a StateValue about to be pushed as raw if the path to it is one of the raw pointers
+         * or it is deep enough, and records which pointers its children can still match.
+         */
+        void mark_raw(const State &state, pda::StateOp<State> &op)
+        {
+            auto push = std::get_if<pda::Push<State>>(&op);
+            auto value = push ? std::get_if<StateValue>(&push->state) : nullptr;
+            if (!value)
+            {
+                return;
+            }
+
+            auto depth = this->raw_candidates.size();
+            auto candidates = std::vector<std::size_t>();
+            value->raw = depth >= this->options.raw_depth;
+            if (!this->raw_candidates.back().empty())
+            {
+                auto object = std::get_if<StateObject>(&state);
+                auto array = std::get_if<StateArray>(&state);
+                for (auto i : this->raw_candidates.back())
+                {
+                    const auto &tokens = this->raw_pointers[i];
+                    auto match = object ? tokens[depth - 1] == object->current_key.value() : JsonPointer::array_index(tokens[depth - 1]) == array->values.size();
+                    if (!match)
+                    {
+                        continue;
+                    }
+                    if (tokens.size() == depth)
+                    {
+                        value->raw = true;
+                    }
+                    else
+                    {
+                        candidates.push_back(i);
+                    }
+                }
+            }
+            this->raw_candidates.push_back(std::move(candidates));
+        }
+
+        // Whether any values are kept raw, so paths need tracking.
+        bool raw = false;
+        // Reference tokens of ParseOptions::raw_pointers.
+        std::vector<std::vector<std::string>> raw_pointers;
+        // For every open StateValue, outermost first, the raw pointers that its children can match.
+        std::vector<std::vector<std::size_t>> raw_candidates;
+
+        /**
+         * Feeds the validator the events of a transition: containers begin when they are pushed, and
+         * elements of a packed array when the array decodes them.
+         *
+         * @param packed the number of decoded elements of state before the transition.
+         */
+        void validate_transition(const State &state, const pda::StateOp<State> &op, std::size_t packed)
+        {
+            if (auto array = std::get_if<StateArray>(&state); array && array->numbers.size() > packed)
+            {
+                this->validator->number(array->numbers.back());
+            }
+            if (auto push = std::get_if<pda::Push<State>>(&op))
+            {
+                if (std::holds_alternative<StateObject>(push->state))
+                {
+                    this->validator->begin_object();
+                }
+                else if (std::holds_alternative<StateArray>(push->state))
+                {
+                    this->validator->begin_array();
+                }
+            }
+        }
+
+        /**
+         * Feeds the validator the events of a pop: containers end, keys and scalars are complete once
+         * they are absorbed into their parent.
+         */
+        void validate_pop(const State &state, const State &popped)
+        {
+            if (std::holds_alternative<StateObject>(popped))
+            {
+                this->validator->end_object();
+            }
+            else if (std::holds_alternative<StateArray>(popped))
+            {
+                this->validator->end_array();
+            }
+            else if (auto object = std::get_if<StateObject>(&state); object && std::holds_alternative<StateString>(popped))
+            {
+                this->validator->key(object->current_key.value());
+            }
+            else if (auto value = std::get_if<StateValue>(&state))
+            {
+                // Also feeds every event of a raw value.
+                this->validator->value(value->m_value.value());
+            }
+        }
+
+        std::optional<schema::Validator> validator;
+    };
+
+    Parser::Parser(const ParseOptions &options) : m_impl(std::make_unique<Impl>(options, nullptr, nullptr)) {}
+
+    Parser::Parser(const ParseOptions &options, ParseStats &stats) : m_impl(std::make_unique<Impl>(options, &stats, nullptr))
+    {
+        stats = ParseStats{};
+    }
+
+    Parser::Parser(const ParseOptions &options, SourceMap &source_map) : m_impl(std::make_unique<Impl>(options, nullptr, &source_map))
+    {
+        source_map.clear();
+    }
+
+    Parser::Parser(Parser &&) noexcept = default;
+    Parser &Parser::operator=(Parser &&) noexcept = default;
+    Parser::~Parser() = default;
+
+    void Parser::feed(const std::string_view chunk)
+    {
+        auto &impl = *this->m_impl;
+        if (impl.finished)
+        {
+            throw std::runtime_error("Parser was already finished");
+        }
+
+        impl.size += chunk.size();
+        impl.limits.check_document(impl.size);
+
+        // The callbacks only capture two references, which std::function stores inline. Capturing
+        // more makes it allocate on every byte.
+        auto position = impl.size - chunk.size();
+        for (size_t i = 0; i < chunk.size(); ++i, ++position)
+        {
+            auto c = chunk[i];
+            auto res = impl.pda.transition(
                 c,
-                [](auto &state, auto c)
+                [&impl, &position](auto &state, auto c)
                 {
-                    return std::visit(
+#ifdef JSONPP_INSTRUMENTATION
+                    auto timer = StateTimer(impl.stats, state);
+#endif
+                    std::size_t packed = 0;
+                    if (auto array = std::get_if<StateArray>(&state); array && impl.validator)
+                    {
+                        packed = array->numbers.size();
+                    }
+                    auto op = std::visit(
                         [c](auto &state)
                         {
                             return state.transition(c);
                         },
                         state);
+                    if (auto push = std::get_if<pda::Push<State>>(&op); push && impl.options.pack_number_arrays)
+                    {
+                        if (auto array = std::get_if<StateArray>(&push->state))
+                        {
+                            array->pack = true;
+                        }
+                    }
+                    if (impl.raw && (std::holds_alternative<StateArray>(state) || std::holds_alternative<StateObject>(state)))
+                    {
+                        impl.mark_raw(state, op);
+                    }
+                    impl.limits.check_transition(state, op);
+                    if (impl.validator)
+                    {
+                        impl.validate_transition(state, op, packed);
+                    }
+                    if (impl.source_map)
+                    {
+                        impl.record_start(state, op, position);
+                    }
+                    return op;
                 },
-                [](auto &state, auto &popped)
+                [&impl, &position](auto &state, auto &popped)
                 {
-                    return std::visit(StatePopOpVisitor{popped}, state);
+#ifdef JSONPP_INSTRUMENTATION
+                    auto timer = StateTimer(impl.stats, state);
+                    count_scratch(impl.stats, popped);
+#endif
+                    impl.limits.check_pop(state, popped);
+                    auto rejection = std::visit(StatePopOpVisitor{std::move(popped)}, state);
+                    impl.limits.check_absorbed(state);
+                    if (impl.raw && std::holds_alternative<StateValue>(popped))
+                    {
+                        impl.raw_candidates.pop_back();
+                    }
+                    if (impl.validator && !rejection)
+                    {
+                        impl.validate_pop(state, popped);
+                    }
+                    if (impl.source_map && !rejection)
+                    {
+                        // Only looks at which kind of state was popped, which moving from it keeps.
+                        impl.record_end(state, popped, position);
+                    }
+                    return rejection;
                 });
 
             auto error = std::get_if<pda::TransitionError>(&res);
@@ -600,9 +1364,19 @@ namespace jsonpp
                     *error);
             }
         }
+    }
+
+    JsonValue Parser::finish()
+    {
+        auto &impl = *this->m_impl;
+        if (impl.finished)
+        {
+            throw std::runtime_error("Parser was already finished");
+        }
+        impl.finished = true;
 
         auto res =
-            pda.finalize(
+            impl.pda.finalize(
                 [](auto &state)
                 {
                     return std::visit(
@@ -618,9 +1392,29 @@ namespace jsonpp
                         },
                         state);
                 },
-                [](auto &state, auto popped)
+                [&impl](auto &state, auto &popped)
                 {
-                    return std::visit(StatePopOpVisitor{popped}, state);
+#ifdef JSONPP_INSTRUMENTATION
+                    auto timer = StateTimer(impl.stats, state);
+                    count_scratch(impl.stats, popped);
+#endif
+                    impl.limits.check_pop(state, popped);
+                    auto rejection = std::visit(StatePopOpVisitor{std::move(popped)}, state);
+                    impl.limits.check_absorbed(state);
+                    if (impl.raw && std::holds_alternative<StateValue>(popped))
+                    {
+                        impl.raw_candidates.pop_back();
+                    }
+                    if (impl.validator && !rejection)
+                    {
+                        impl.validate_pop(state, popped);
+                    }
+                    if (impl.source_map && !rejection)
+                    {
+                        // Only looks at which kind of state was popped, which moving from it keeps.
+                        impl.record_end(state, popped, impl.size);
+                    }
+                    return rejection;
                 });
 
         if (auto error = std::get_if<pda::FinalizeError>(&res))
@@ -634,12 +1428,12 @@ namespace jsonpp
                 *error);
         }
 
-        auto final_state = std::get<State>(res);
+        auto final_state = std::get<State>(std::move(res));
 
         auto final_state_res = std::visit(
             [](auto &state)
             {
-                return state.finalize();
+                return std::move(state).finalize();
             },
             final_state);
         auto error = std::get_if<std::string>(&final_state_res);
@@ -647,8 +1441,311 @@ namespace jsonpp
         {
             throw std::runtime_error(*error);
         }
-        auto value = std::get<JsonValue>(final_state_res);
+#ifdef JSONPP_INSTRUMENTATION
+        impl.recorder.record();
+#endif
+        return std::get<JsonValue>(std::move(final_state_res));
+    }
+
+    static JsonValue parse_document(const std::string_view json_str, const ParseOptions &options, ParseStats *stats)
+    {
+        auto parser = stats ? Parser(options, *stats) : Parser(options);
+        parser.feed(json_str);
+        return parser.finish();
+    }
+
+    JsonValue JsonValue::parse(const std::string_view json_str)
+    {
+        return parse_document(json_str, ParseOptions{}, nullptr);
+    }
+
+    JsonValue JsonValue::parse(const std::string_view json_str, ParseStats &stats)
+    {
+        stats = ParseStats{};
+        return parse_document(json_str, ParseOptions{}, &stats);
+    }
+
+    JsonValue JsonValue::parse(const std::string_view json_str, const ParseOptions &options)
+    {
+        return parse_document(json_str, options, nullptr);
+    }
+
+    JsonValue JsonValue::parse(const std::string_view json_str, const ParseOptions &options, ParseStats &stats)
+    {
+        stats = ParseStats{};
+        return parse_document(json_str, options, &stats);
+    }
+
+    JsonValue JsonValue::parse(const std::string_view json_str, const ParseOptions &options, SourceMap &source_map)
+    {
+        auto parser = Parser(options, source_map);
+        parser.feed(json_str);
+        return parser.finish();
+    }
+
+    /**
+     * Scrambles the bits of a hash so that sums and sequences of hashes do not collide easily.
+     */
+    static std::size_t mix_hash(std::uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return static_cast<std::size_t>(h);
+    }
+
+    /**
+     * @return the hash of a number, the same for a boxed double and an element of a JsonNumberArray.
+     */
+    static std::size_t hash_number(double d)
+    {
+        auto h = mix_hash(std::hash<double>{}(d == 0 ? 0.0 : d) + 4);
+        // 0 is never cached, see below.
+        return h == 0 ? 1 : h;
+    }
+
+    /**
+     * @return the hash of one node, with the hashes of its children read from their caches.
+     */
+    static std::size_t hash_variant(const JsonValueVariant &value)
+    {
+        return std::visit(
+            utils::inline_visitor{
+                [](const JsonObject &o)
+                {
+                    // Members are summed so that their order does not matter.
+                    std::size_t h = o.size();
+                    for (const auto &[key, value] : o)
+                    {
+                        h += mix_hash(std::hash<std::string>{}(key) ^ mix_hash(value.hash()));
+                    }
+                    return mix_hash(h + 1);
+                },
+                [](const JsonArray &a)
+                {
+                    std::size_t h = a.size();
+                    for (const auto &value : a)
+                    {
+                        h = mix_hash(h + value.hash());
+                    }
+                    return mix_hash(h + 2);
+                },
+                [](const std::string &s)
+                { return mix_hash(std::hash<std::string>{}(s) + 3); },
+                [](const double &d)
+                { return hash_number(d); },
+                [](const bool &b)
+                { return mix_hash(b + 5); },
+                [](const JsonNumberArray &a)
+                {
+                    // Same as the JsonArray of the same numbers.
+                    std::size_t h = a.size();
+                    for (auto d : a)
+                    {
+                        h = mix_hash(h + hash_number(d));
+                    }
+                    return mix_hash(h + 2);
+                },
+                [](const JsonRaw &r)
+                {
+                    // Same as the value the text parses to.
+                    return JsonValue::parse(r.text).hash();
+                },
+            },
+            value);
+    }
+
+    std::size_t JsonValue::hash() const
+    {
+        if (!this->m_value)
+        {
+            return mix_hash(0);
+        }
+
+        // Nodes are hashed children first, so that hash_variant only ever reads cached hashes and
+        // deep documents need no recursion.
+        auto pending = std::vector<const Node *>{this->m_value.get()};
+        while (!pending.empty())
+        {
+            auto node = pending.back();
+            if (node->hash.load(std::memory_order_relaxed) != 0)
+            {
+                pending.pop_back();
+                continue;
+            }
+
+            auto size = pending.size();
+            auto push = [&pending](const JsonValue &child)
+            {
+                const auto &inner = child.m_value;
+                if (inner && inner->hash.load(std::memory_order_relaxed) == 0 &&
+                    (std::holds_alternative<JsonObject>(inner->value) || std::holds_alternative<JsonArray>(inner->value)))
+                {
+                    pending.push_back(inner.get());
+                }
+            };
+            if (auto object = std::get_if<JsonObject>(&node->value))
+            {
+                for (const auto &member : *object)
+                {
+                    push(member.second);
+                }
+            }
+            else if (auto array = std::get_if<JsonArray>(&node->value))
+            {
+                for (const auto &element : *array)
+                {
+                    push(element);
+                }
+            }
+            if (pending.size() != size)
+            {
+                continue;
+            }
+
+            pending.pop_back();
+            auto hash = hash_variant(node->value);
+            // 0 marks a hash that has not been computed yet.
+            node->hash.store(hash == 0 ? 1 : hash, std::memory_order_relaxed);
+        }
+        return this->m_value->hash.load(std::memory_order_relaxed);
+    }
 
-        return value;
+    static bool equals_packed(const JsonNumberArray &packed, const JsonArray &boxed)
+    {
+        return std::equal(packed.begin(), packed.end(), boxed.begin(), boxed.end(), [](double d, const JsonValue &value)
+                          {
+                              auto inner = value.value();
+                              auto number = inner ? std::get_if<double>(&inner->get()) : nullptr;
+                              return number && *number == d; });
     }
+
+    bool JsonValue::equals(const JsonValue &other) const
+    {
+        // Pairs of values still to compare. Containers add their children instead of recursing, so
+        // deep documents are compared with an explicit stack.
+        auto pending = std::vector<std::pair<const JsonValue *, const JsonValue *>>{{this, &other}};
+        // Values parsed from raw text. A deque does not move them when it grows.
+        auto parsed = std::deque<JsonValue>();
+        while (!pending.empty())
+        {
+            auto [left_value, right_value] = pending.back();
+            pending.pop_back();
+            const auto &left_node = left_value->m_value;
+            const auto &right_node = right_value->m_value;
+            if (left_node == right_node)
+            {
+                continue;
+            }
+
+            auto left_raw = left_node ? std::get_if<JsonRaw>(&left_node->value) : nullptr;
+            auto right_raw = right_node ? std::get_if<JsonRaw>(&right_node->value) : nullptr;
+            if (left_raw || right_raw)
+            {
+                // Raw text equals the value it parses to, so the same text is only a shortcut.
+                if (left_raw && right_raw && left_raw->text == right_raw->text)
+                {
+                    continue;
+                }
+                if (left_raw)
+                {
+                    left_value = &parsed.emplace_back(JsonValue::parse(left_raw->text));
+                }
+                if (right_raw)
+                {
+                    right_value = &parsed.emplace_back(JsonValue::parse(right_raw->text));
+                }
+                pending.push_back({left_value, right_value});
+                continue;
+            }
+
+            if (!left_node || !right_node)
+            {
+                return false;
+            }
+
+            auto hash = left_node->hash.load(std::memory_order_relaxed);
+            auto other_hash = right_node->hash.load(std::memory_order_relaxed);
+            if (hash != 0 && other_hash != 0 && hash != other_hash)
+            {
+                return false;
+            }
+
+            const auto &left = left_node->value;
+            const auto &right = right_node->value;
+            if (left.index() != right.index())
+            {
+                // A packed array equals the boxed array of the same numbers.
+                auto packed = std::get_if<JsonNumberArray>(&left);
+                auto boxed = std::get_if<JsonArray>(&right);
+                if (!packed)
+                {
+                    packed = std::get_if<JsonNumberArray>(&right);
+                    boxed = std::get_if<JsonArray>(&left);
+                }
+                if (!packed || !boxed || !equals_packed(*packed, *boxed))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            auto equal = std::visit(
+                utils::inline_visitor{
+                    [&](const JsonObject &o)
+                    {
+                        const auto &other = std::get<JsonObject>(right);
+                        if (o.size() != other.size())
+                        {
+                            return false;
+                        }
+                        for (const auto &[key, value] : o)
+                        {
+                            auto it = other.find(key);
+                            if (it == other.end())
+                            {
+                                return false;
+                            }
+                            pending.push_back({&value, &it->second});
+                        }
+                        return true;
+                    },
+                    [&](const JsonArray &a)
+                    {
+                        const auto &other = std::get<JsonArray>(right);
+                        if (a.size() != other.size())
+                        {
+                            return false;
+                        }
+                        for (std::size_t i = 0; i < a.size(); ++i)
+                        {
+                            pending.push_back({&a[i], &other[i]});
+                        }
+                        return true;
+                    },
+                    [&](const std::string &s)
+                    { return s == std::get<std::string>(right); },
+                    [&](const double &d)
+                    { return d == std::get<double>(right); },
+                    [&](const bool &b)
+                    { return b == std::get<bool>(right); },
+                    [&](const JsonNumberArray &a)
+                    { return a == std::get<JsonNumberArray>(right); },
+                    [](const JsonRaw &)
+                    {
+                        // Handled above.
+                        return false;
+                    },
+                },
+                left);
+            if (!equal)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
 }
\ No newline at end of file
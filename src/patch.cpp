@@ -0,0 +1,631 @@
+#include "patch.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "query.hpp"
+
+namespace jsonpp::patch
+{
+
+    namespace
+    {
+
+        struct Operation
+        {
+            std::string op;
+            JsonPointer path;
+            std::optional<JsonPointer> from;
+            std::optional<JsonValue> value;
+        };
+
+        const std::string &token(const PathSegment &segment)
+        {
+            return std::get<PathToken>(segment).token;
+        }
+
+        /**
+         * @return true if the first count segments of both paths are the same.
+         */
+        bool same_prefix(const std::vector<PathSegment> &a, const std::vector<PathSegment> &b, std::size_t count)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (token(a[i]) != token(b[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const JsonValue *find_member(const JsonObject &object, const std::string &name)
+        {
+            auto it = object.find(name);
+            return it == object.end() ? nullptr : &it->second;
+        }
+
+        const std::string &string_member(const JsonObject &object, const std::string &name)
+        {
+            auto member = find_member(object, name);
+            auto inner = member ? member->value() : std::nullopt;
+            if (!inner || !std::holds_alternative<std::string>(inner->get()))
+            {
+                throw std::runtime_error("JSON Patch operation is missing string member '" + name + "'");
+            }
+            return std::get<std::string>(inner->get());
+        }
+
+        std::vector<Operation> read_operations(const JsonValue &patch)
+        {
+            auto inner = patch.value();
+            if (!inner || !std::holds_alternative<JsonArray>(inner->get()))
+            {
+                throw std::runtime_error("JSON Patch must be an array");
+            }
+
+            auto operations = std::vector<Operation>();
+            for (const auto &element : std::get<JsonArray>(inner->get()))
+            {
+                auto object = element.value();
+                if (!object || !std::holds_alternative<JsonObject>(object->get()))
+                {
+                    throw std::runtime_error("JSON Patch operation must be an object");
+                }
+                const auto &members = std::get<JsonObject>(object->get());
+
+                auto operation = Operation{string_member(members, "op"), JsonPointer::parse(string_member(members, "path")), std::nullopt, std::nullopt};
+                if (operation.op == "move" || operation.op == "copy")
+                {
+                    operation.from = JsonPointer::parse(string_member(members, "from"));
+                }
+                else if (operation.op == "add" || operation.op == "replace" || operation.op == "test")
+                {
+                    auto value = find_member(members, "value");
+                    if (!value)
+                    {
+                        throw std::runtime_error("JSON Patch operation is missing member 'value'");
+                    }
+                    operation.value = *value;
+                }
+                else if (operation.op != "remove")
+                {
+                    throw std::runtime_error("Unknown JSON Patch operation '" + operation.op + "'");
+                }
+                operations.push_back(std::move(operation));
+            }
+            return operations;
+        }
+
+        /**
+         * @return the array held by inner, or nullptr if it holds none. A packed JsonNumberArray is
+         * boxed into a JsonArray first, so its elements can be changed like any other.
+         */
+        JsonArray *mutable_array(JsonValueVariant &inner)
+        {
+            if (auto numbers = std::get_if<JsonNumberArray>(&inner))
+            {
+                auto boxed = JsonArray();
+                boxed.reserve(numbers->size());
+                for (auto d : *numbers)
+                {
+                    boxed.emplace_back(d);
+                }
+                inner = std::move(boxed);
+            }
+            return std::get_if<JsonArray>(&inner);
+        }
+
+        /**
+         * Walks the first count segments of a path, making every container on the way unique to
+         * document so it can be modified.
+         */
+        JsonValue &resolve(JsonValue &document, const std::vector<PathSegment> &segments, std::size_t count)
+        {
+            auto current = &document;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                auto inner = current->mutable_value();
+                if (!inner)
+                {
+                    throw std::runtime_error("JSON Patch path does not exist");
+                }
+
+                if (auto object = std::get_if<JsonObject>(&inner->get()))
+                {
+                    auto it = object->find(token(segments[i]));
+                    if (it == object->end())
+                    {
+                        throw std::runtime_error("JSON Patch path does not exist");
+                    }
+                    current = &it->second;
+                }
+                else if (auto array = mutable_array(inner->get()))
+                {
+                    auto index = JsonPointer::array_index(token(segments[i]));
+                    if (!index || index.value() >= array->size())
+                    {
+                        throw std::runtime_error("JSON Patch path does not exist");
+                    }
+                    current = &(*array)[index.value()];
+                }
+                else
+                {
+                    throw std::runtime_error("JSON Patch path does not exist");
+                }
+            }
+            return *current;
+        }
+
+        void add(JsonValue &document, const std::vector<PathSegment> &segments, JsonValue value)
+        {
+            if (segments.empty())
+            {
+                document = std::move(value);
+                return;
+            }
+
+            auto inner = resolve(document, segments, segments.size() - 1).mutable_value();
+            const auto &name = token(segments.back());
+            if (auto object = inner ? std::get_if<JsonObject>(&inner->get()) : nullptr)
+            {
+                object->insert_or_assign(name, std::move(value));
+            }
+            else if (auto array = inner ? mutable_array(inner->get()) : nullptr)
+            {
+                if (name == "-")
+                {
+                    array->push_back(std::move(value));
+                    return;
+                }
+
+                auto index = JsonPointer::array_index(name);
+                if (!index || index.value() > array->size())
+                {
+                    throw std::runtime_error("JSON Patch array index is out of bounds");
+                }
+                array->insert(array->begin() + index.value(), std::move(value));
+            }
+            else
+            {
+                throw std::runtime_error("JSON Patch path does not exist");
+            }
+        }
+
+        JsonValue remove(JsonValue &document, const std::vector<PathSegment> &segments)
+        {
+            if (segments.empty())
+            {
+                return std::exchange(document, JsonValue(nullptr));
+            }
+
+            auto inner = resolve(document, segments, segments.size() - 1).mutable_value();
+            const auto &name = token(segments.back());
+            if (auto object = inner ? std::get_if<JsonObject>(&inner->get()) : nullptr)
+            {
+                if (auto it = object->find(name); it != object->end())
+                {
+                    auto removed = std::move(it->second);
+                    object->erase(it);
+                    return removed;
+                }
+            }
+            else if (auto array = inner ? mutable_array(inner->get()) : nullptr)
+            {
+                if (auto index = JsonPointer::array_index(name); index && index.value() < array->size())
+                {
+                    auto removed = std::move((*array)[index.value()]);
+                    array->erase(array->begin() + index.value());
+                    return removed;
+                }
+            }
+            throw std::runtime_error("JSON Patch path does not exist");
+        }
+
+        /**
+         * Finds the value at a path without changing the document. Unlike JsonPointer::evaluate this
+         * also reaches the elements of a packed JsonNumberArray.
+         */
+        JsonValue lookup(const JsonValue &document, const JsonPointer &pointer)
+        {
+            auto current = &document;
+            // The element last read from a packed array.
+            auto element = JsonValue(nullptr);
+            for (const auto &segment : pointer.segments())
+            {
+                auto inner = current->value();
+                if (auto object = inner ? std::get_if<JsonObject>(&inner->get()) : nullptr)
+                {
+                    if (auto it = object->find(token(segment)); it != object->end())
+                    {
+                        current = &it->second;
+                        continue;
+                    }
+                }
+                else if (auto array = inner ? std::get_if<JsonArray>(&inner->get()) : nullptr)
+                {
+                    if (auto index = JsonPointer::array_index(token(segment)); index && index.value() < array->size())
+                    {
+                        current = &(*array)[index.value()];
+                        continue;
+                    }
+                }
+                else if (auto numbers = inner ? std::get_if<JsonNumberArray>(&inner->get()) : nullptr)
+                {
+                    if (auto index = JsonPointer::array_index(token(segment)); index && index.value() < numbers->size())
+                    {
+                        element = JsonValue((*numbers)[index.value()]);
+                        current = &element;
+                        continue;
+                    }
+                }
+                throw std::runtime_error("JSON Patch path does not exist");
+            }
+            return *current;
+        }
+
+        void apply_operation(JsonValue &document, const Operation &operation)
+        {
+            const auto &path = operation.path.segments();
+            if (operation.op == "add")
+            {
+                add(document, path, operation.value.value());
+            }
+            else if (operation.op == "remove")
+            {
+                remove(document, path);
+            }
+            else if (operation.op == "replace")
+            {
+                resolve(document, path, path.size()) = operation.value.value();
+            }
+            else if (operation.op == "move")
+            {
+                const auto &from = operation.from->segments();
+                if (from.size() <= path.size() && same_prefix(from, path, from.size()))
+                {
+                    if (from.size() < path.size())
+                    {
+                        throw std::runtime_error("JSON Patch cannot move a value into itself");
+                    }
+                    return;
+                }
+                add(document, path, remove(document, from));
+            }
+            else if (operation.op == "copy")
+            {
+                add(document, path, lookup(document, operation.from.value()));
+            }
+            else if (operation.op == "test")
+            {
+                if (!lookup(document, operation.path).equals(operation.value.value()))
+                {
+                    throw std::runtime_error("JSON Patch test failed");
+                }
+            }
+        }
+
+        /**
+         * Appends a reference token to a JSON Pointer, escaping '~' and '/'.
+         */
+        std::string append_token(const std::string &path, std::string_view name)
+        {
+            auto out = path + '/';
+            for (auto c : name)
+            {
+                if (c == '~')
+                {
+                    out.append("~0");
+                }
+                else if (c == '/')
+                {
+                    out.append("~1");
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+            return out;
+        }
+
+        JsonValue make_operation(const char *op, std::string path, std::optional<JsonValue> value)
+        {
+            auto operation = JsonObject();
+            operation.emplace("op", JsonValue(std::string(op)));
+            operation.emplace("path", JsonValue(std::move(path)));
+            if (value)
+            {
+                operation.emplace("value", std::move(value.value()));
+            }
+            return JsonValue(std::move(operation));
+        }
+
+        bool is_array(const JsonValueVariant &value)
+        {
+            return std::holds_alternative<JsonArray>(value) || std::holds_alternative<JsonNumberArray>(value);
+        }
+
+        /**
+         * Two values to diff, and the path of both.
+         */
+        struct Compare
+        {
+            const JsonValue *from;
+            const JsonValue *to;
+            std::string path;
+        };
+
+        void diff_values(const JsonValue &from, const JsonValue &to, JsonArray &out)
+        {
+            // Comparisons still to do and finished operations, in reverse order. A container pushes
+            // everything it produces at once instead of recursing, so the operations come out in the
+            // same order a depth-first walk would write them.
+            auto pending = std::vector<std::variant<Compare, JsonValue>>();
+            pending.push_back(Compare{&from, &to, std::string()});
+            auto work = std::vector<std::variant<Compare, JsonValue>>();
+            // Boxed copies of packed number arrays that differ, so their elements can be compared
+            // like those of any other array. A deque keeps the pointers on the stack valid.
+            auto boxed = std::deque<JsonValue>();
+            auto as_array = [&boxed](const JsonValueVariant &value) -> const JsonArray *
+            {
+                if (auto numbers = std::get_if<JsonNumberArray>(&value))
+                {
+                    auto array = JsonArray();
+                    array.reserve(numbers->size());
+                    for (auto d : *numbers)
+                    {
+                        array.emplace_back(d);
+                    }
+                    boxed.emplace_back(std::move(array));
+                    return &std::get<JsonArray>(boxed.back().value()->get());
+                }
+                return std::get_if<JsonArray>(&value);
+            };
+            while (!pending.empty())
+            {
+                auto item = std::move(pending.back());
+                pending.pop_back();
+                if (auto operation = std::get_if<JsonValue>(&item))
+                {
+                    out.push_back(std::move(*operation));
+                    continue;
+                }
+
+                auto &[from_value, to_value, path] = std::get<Compare>(item);
+                if (from_value->shares(*to_value) || (from_value->hash() == to_value->hash() && from_value->equals(*to_value)))
+                {
+                    continue;
+                }
+
+                work.clear();
+                auto left = from_value->value();
+                auto right = to_value->value();
+                if (left && right)
+                {
+                    auto object = std::get_if<JsonObject>(&left->get());
+                    auto other_object = std::get_if<JsonObject>(&right->get());
+                    if (object && other_object)
+                    {
+                        const auto &other = *other_object;
+                        for (const auto &[key, value] : *object)
+                        {
+                            if (auto it = other.find(key); it == other.end())
+                            {
+                                work.push_back(make_operation("remove", append_token(path, key), std::nullopt));
+                            }
+                            else
+                            {
+                                work.push_back(Compare{&value, &it->second, append_token(path, key)});
+                            }
+                        }
+                        for (const auto &[key, value] : other)
+                        {
+                            if (object->find(key) == object->end())
+                            {
+                                work.push_back(make_operation("add", append_token(path, key), value));
+                            }
+                        }
+                    }
+                    else if (is_array(left->get()) && is_array(right->get()))
+                    {
+                        auto array = as_array(left->get());
+                        const auto &other = *as_array(right->get());
+                        auto common = std::min(array->size(), other.size());
+                        for (std::size_t i = 0; i < common; ++i)
+                        {
+                            work.push_back(Compare{&(*array)[i], &other[i], append_token(path, std::to_string(i))});
+                        }
+                        // Remove from the end so that earlier indices stay valid.
+                        for (auto i = array->size(); i > common; --i)
+                        {
+                            work.push_back(make_operation("remove", append_token(path, std::to_string(i - 1)), std::nullopt));
+                        }
+                        for (auto i = common; i < other.size(); ++i)
+                        {
+                            work.push_back(make_operation("add", append_token(path, std::to_string(i)), other[i]));
+                        }
+                    }
+                }
+                if (work.empty())
+                {
+                    pending.push_back(make_operation("replace", path, *to_value));
+                    continue;
+                }
+                std::move(work.rbegin(), work.rend(), std::back_inserter(pending));
+            }
+        }
+
+        /**
+         * @return true if the patch can be spliced into the text: it only replaces or tests values,
+         * and no path lies inside another one.
+         */
+        bool can_splice(const std::vector<Operation> &operations)
+        {
+            for (std::size_t i = 0; i < operations.size(); ++i)
+            {
+                if (operations[i].op != "replace" && operations[i].op != "test")
+                {
+                    return false;
+                }
+
+                const auto &a = operations[i].path.segments();
+                for (std::size_t j = 0; j < i; ++j)
+                {
+                    const auto &b = operations[j].path.segments();
+                    if (a.size() != b.size() && same_prefix(a, b, std::min(a.size(), b.size())))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+    }
+
+    void apply(JsonValue &document, const JsonValue &patch)
+    {
+        // Copying shares every node, and a failed patch simply drops the partially patched copy.
+        auto result = document;
+        for (const auto &operation : read_operations(patch))
+        {
+            apply_operation(result, operation);
+        }
+        document = std::move(result);
+    }
+
+    JsonValue diff(const JsonValue &from, const JsonValue &to)
+    {
+        auto out = JsonArray();
+        diff_values(from, to, out);
+        return JsonValue(std::move(out));
+    }
+
+    void merge(JsonValue &document, const JsonValue &patch)
+    {
+        // Nested objects are merged from an explicit stack, so a deep patch cannot overflow the
+        // call stack. Each entry holds its patch, which keeps the patch's nodes shared while the
+        // document is changed, so a patch taken from the document itself is never modified.
+        auto pending = std::vector<std::pair<JsonValue *, JsonValue>>();
+        pending.emplace_back(&document, patch);
+        while (!pending.empty())
+        {
+            auto [target, source] = std::move(pending.back());
+            pending.pop_back();
+
+            auto inner = source.value();
+            if (!inner || !std::holds_alternative<JsonObject>(inner->get()))
+            {
+                *target = source;
+                continue;
+            }
+
+            auto current = target->value();
+            if (!current || !std::holds_alternative<JsonObject>(current->get()))
+            {
+                *target = JsonValue(JsonObject());
+            }
+
+            // Members of an unordered_map keep their address while others are inserted or erased.
+            auto &object = std::get<JsonObject>(target->mutable_value()->get());
+            for (const auto &[name, value] : std::get<JsonObject>(inner->get()))
+            {
+                auto member = value.value();
+                if (!member)
+                {
+                    object.erase(name);
+                }
+                else if (std::holds_alternative<JsonObject>(member->get()))
+                {
+                    pending.emplace_back(&object.try_emplace(name, nullptr).first->second, value);
+                }
+                else
+                {
+                    object.insert_or_assign(name, value);
+                }
+            }
+        }
+    }
+
+    std::string splice(std::string_view json_str, const JsonValue &patch)
+    {
+        auto operations = read_operations(patch);
+        if (!can_splice(operations))
+        {
+            auto document = JsonValue::parse(json_str);
+            apply(document, patch);
+            return document.json();
+        }
+
+        // Operations on the same path share a target.
+        auto pointers = std::vector<JsonPointer>();
+        auto targets = std::vector<std::size_t>();
+        for (const auto &operation : operations)
+        {
+            const auto &path = operation.path.segments();
+            auto it = std::find_if(pointers.begin(), pointers.end(), [&path](const auto &pointer)
+                                   { return pointer.segments().size() == path.size() && same_prefix(pointer.segments(), path, path.size()); });
+            targets.push_back(it - pointers.begin());
+            if (it == pointers.end())
+            {
+                pointers.push_back(operation.path);
+            }
+        }
+
+        auto spans = PathMatcher::compile(pointers).locate(json_str);
+        auto replacements = std::vector<std::optional<JsonValue>>(pointers.size());
+        for (std::size_t i = 0; i < operations.size(); ++i)
+        {
+            auto target = targets[i];
+            if (!spans[target])
+            {
+                throw std::runtime_error("JSON Patch path does not exist");
+            }
+
+            if (operations[i].op == "replace")
+            {
+                replacements[target] = operations[i].value;
+            }
+            else
+            {
+                auto current = replacements[target] ? replacements[target].value() : JsonValue::parse(spans[target].value());
+                if (!current.equals(operations[i].value.value()))
+                {
+                    throw std::runtime_error("JSON Patch test failed");
+                }
+            }
+        }
+
+        // Targets do not overlap, so the replacements can be written in document order.
+        auto order = std::vector<std::size_t>();
+        for (std::size_t target = 0; target < pointers.size(); ++target)
+        {
+            if (replacements[target])
+            {
+                order.push_back(target);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&spans](auto a, auto b)
+                  { return spans[a]->data() < spans[b]->data(); });
+
+        auto out = std::string();
+        std::size_t position = 0;
+        for (auto target : order)
+        {
+            auto offset = static_cast<std::size_t>(spans[target]->data() - json_str.data());
+            out.append(json_str.substr(position, offset - position));
+            out.append(replacements[target]->json());
+            position = offset + spans[target]->size();
+        }
+        out.append(json_str.substr(position));
+        return out;
+    }
+
+}
@@ -0,0 +1,630 @@
+#include "query.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+#include "utils.hpp"
+#include "scanner.hpp"
+
+namespace jsonpp
+{
+
+    namespace
+    {
+
+        /**
+         * Parses an RFC 6901 array index: "0" or a decimal number without leading zeros. Indices
+         * that do not fit in std::size_t cannot name an element and are not indices either.
+         */
+        std::optional<std::size_t> parse_array_index(std::string_view token)
+        {
+            if (token.empty() || (token.size() > 1 && token[0] == '0'))
+            {
+                return std::nullopt;
+            }
+
+            std::size_t index = 0;
+            for (auto c : token)
+            {
+                if (!std::isdigit(static_cast<unsigned char>(c)))
+                {
+                    return std::nullopt;
+                }
+                auto digit = static_cast<std::size_t>(c - '0');
+                if (index > (std::numeric_limits<std::size_t>::max() - digit) / 10)
+                {
+                    return std::nullopt;
+                }
+                index = index * 10 + digit;
+            }
+            return index;
+        }
+
+        bool matches_member(const PathSegment &segment, std::string_view key)
+        {
+            return std::visit(
+                utils::inline_visitor{
+                    [key](const PathToken &s)
+                    { return s.token == key; },
+                    [key](const PathMember &s)
+                    { return s.name == key; },
+                    [](const PathIndex &)
+                    { return false; },
+                    [](const PathWildcard &)
+                    { return true; },
+                },
+                segment);
+        }
+
+        /**
+         * @return the array index segment selects, or nothing if it selects no element or, for a
+         * wildcard, every element.
+         */
+        std::optional<std::size_t> segment_index(const PathSegment &segment)
+        {
+            return std::visit(
+                utils::inline_visitor{
+                    [](const PathToken &s)
+                    { return parse_array_index(s.token); },
+                    [](const PathMember &)
+                    { return std::optional<std::size_t>(); },
+                    [](const PathIndex &s)
+                    { return std::optional<std::size_t>(s.index); },
+                    [](const PathWildcard &)
+                    { return std::optional<std::size_t>(); },
+                },
+                segment);
+        }
+
+        bool matches_index(const PathSegment &segment, std::size_t index)
+        {
+            return std::holds_alternative<PathWildcard>(segment) || segment_index(segment) == index;
+        }
+
+        void evaluate_segments(
+            const JsonValue &value,
+            const std::vector<PathSegment> &segments,
+            std::size_t i,
+            std::vector<std::reference_wrapper<const JsonValue>> &out)
+        {
+            if (i == segments.size())
+            {
+                out.push_back(std::cref(value));
+                return;
+            }
+
+            auto inner = value.value();
+            if (!inner)
+            {
+                return;
+            }
+
+            const auto &segment = segments[i];
+            if (auto object = std::get_if<JsonObject>(&inner->get()))
+            {
+                if (std::holds_alternative<PathWildcard>(segment))
+                {
+                    for (const auto &[key, child] : *object)
+                    {
+                        evaluate_segments(child, segments, i + 1, out);
+                    }
+                }
+                else if (auto name = std::get_if<PathToken>(&segment))
+                {
+                    if (auto it = object->find(name->token); it != object->end())
+                    {
+                        evaluate_segments(it->second, segments, i + 1, out);
+                    }
+                }
+                else if (auto name = std::get_if<PathMember>(&segment))
+                {
+                    if (auto it = object->find(name->name); it != object->end())
+                    {
+                        evaluate_segments(it->second, segments, i + 1, out);
+                    }
+                }
+            }
+            else if (auto array = std::get_if<JsonArray>(&inner->get()))
+            {
+                if (std::holds_alternative<PathWildcard>(segment))
+                {
+                    for (const auto &element : *array)
+                    {
+                        evaluate_segments(element, segments, i + 1, out);
+                    }
+                }
+                else if (auto index = segment_index(segment); index && *index < array->size())
+                {
+                    evaluate_segments((*array)[*index], segments, i + 1, out);
+                }
+            }
+        }
+
+        /**
+         * Matches segments against the value starting at token, consuming that value entirely unless
+         * the limit is reached.
+         *
+         * @return true once out holds limit values and scanning should stop.
+         */
+        bool extract_segments(
+            scan::Tokenizer &tokenizer,
+            const scan::Token &token,
+            const std::vector<PathSegment> &segments,
+            std::size_t i,
+            std::vector<JsonValue> &out,
+            std::size_t limit)
+        {
+            if (i == segments.size())
+            {
+                out.push_back(JsonValue::parse(tokenizer.span(token)));
+                return out.size() >= limit;
+            }
+
+            const auto &segment = segments[i];
+            // Only a wildcard can match more than one child of the same container.
+            auto unique = !std::holds_alternative<PathWildcard>(segment);
+
+            if (token.type == scan::BeginObject)
+            {
+                while (1)
+                {
+                    auto key = tokenizer.next();
+                    if (key.type == scan::EndObject)
+                    {
+                        return false;
+                    }
+
+                    auto value = tokenizer.next();
+                    if (!matches_member(segment, key.text))
+                    {
+                        tokenizer.span(value);
+                        continue;
+                    }
+
+                    if (extract_segments(tokenizer, value, segments, i + 1, out, limit))
+                    {
+                        return true;
+                    }
+                    if (unique)
+                    {
+                        tokenizer.skip();
+                        return false;
+                    }
+                }
+            }
+            else if (token.type == scan::BeginArray)
+            {
+                for (std::size_t index = 0;; ++index)
+                {
+                    auto value = tokenizer.next();
+                    if (value.type == scan::EndArray)
+                    {
+                        return false;
+                    }
+
+                    if (!matches_index(segment, index))
+                    {
+                        tokenizer.span(value);
+                        continue;
+                    }
+
+                    if (extract_segments(tokenizer, value, segments, i + 1, out, limit))
+                    {
+                        return true;
+                    }
+                    if (unique)
+                    {
+                        tokenizer.skip();
+                        return false;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        std::vector<JsonValue> extract_segments(std::string_view json_str, const std::vector<PathSegment> &segments, std::size_t limit)
+        {
+            auto out = std::vector<JsonValue>();
+            auto tokenizer = scan::Tokenizer(json_str);
+            extract_segments(tokenizer, tokenizer.next(), segments, 0, out, limit);
+            return out;
+        }
+
+    }
+
+    JsonPointer JsonPointer::parse(std::string_view pointer)
+    {
+        auto segments = std::vector<PathSegment>();
+        if (pointer.empty())
+        {
+            return JsonPointer(segments);
+        }
+        if (pointer[0] != '/')
+        {
+            throw std::runtime_error("JSON Pointer must be empty or start with '/'");
+        }
+
+        auto token = std::string();
+        for (std::size_t i = 1; i <= pointer.size(); ++i)
+        {
+            if (i == pointer.size() || pointer[i] == '/')
+            {
+                segments.push_back(PathToken{token});
+                token.clear();
+            }
+            else if (pointer[i] == '~')
+            {
+                if (i + 1 < pointer.size() && pointer[i + 1] == '0')
+                {
+                    token.push_back('~');
+                }
+                else if (i + 1 < pointer.size() && pointer[i + 1] == '1')
+                {
+                    token.push_back('/');
+                }
+                else
+                {
+                    throw std::runtime_error("Invalid escape sequence in JSON Pointer");
+                }
+                ++i;
+            }
+            else
+            {
+                token.push_back(pointer[i]);
+            }
+        }
+
+        return JsonPointer(segments);
+    }
+
+    std::optional<std::reference_wrapper<const JsonValue>> JsonPointer::evaluate(const JsonValue &root) const
+    {
+        auto out = std::vector<std::reference_wrapper<const JsonValue>>();
+        evaluate_segments(root, this->m_segments, 0, out);
+        if (out.empty())
+        {
+            return std::nullopt;
+        }
+        return out.front();
+    }
+
+    std::optional<JsonValue> JsonPointer::extract(std::string_view json_str) const
+    {
+        auto out = extract_segments(json_str, this->m_segments, 1);
+        if (out.empty())
+        {
+            return std::nullopt;
+        }
+        return out.front();
+    }
+
+    std::optional<std::size_t> JsonPointer::array_index(std::string_view token)
+    {
+        return parse_array_index(token);
+    }
+
+    JsonPath JsonPath::parse(std::string_view path)
+    {
+        if (path.empty() || path[0] != '$')
+        {
+            throw std::runtime_error("JSONPath must start with '$'");
+        }
+
+        auto segments = std::vector<PathSegment>();
+        std::size_t i = 1;
+        while (i < path.size())
+        {
+            if (path[i] == '.')
+            {
+                ++i;
+                if (i < path.size() && path[i] == '*')
+                {
+                    segments.push_back(PathWildcard{});
+                    ++i;
+                    continue;
+                }
+
+                auto end = path.find_first_of(".[", i);
+                if (end == std::string_view::npos)
+                {
+                    end = path.size();
+                }
+                if (end == i)
+                {
+                    throw std::runtime_error("Expected member name in JSONPath");
+                }
+                segments.push_back(PathMember{std::string(path.substr(i, end - i))});
+                i = end;
+            }
+            else if (path[i] == '[')
+            {
+                ++i;
+                if (i < path.size() && path[i] == '*')
+                {
+                    segments.push_back(PathWildcard{});
+                    ++i;
+                }
+                else if (i < path.size() && (path[i] == '\'' || path[i] == '"'))
+                {
+                    auto end = path.find(path[i], i + 1);
+                    if (end == std::string_view::npos)
+                    {
+                        throw std::runtime_error("Missing closing quote in JSONPath");
+                    }
+                    segments.push_back(PathMember{std::string(path.substr(i + 1, end - i - 1))});
+                    i = end + 1;
+                }
+                else
+                {
+                    auto end = path.find(']', i);
+                    auto index = parse_array_index(path.substr(i, end == std::string_view::npos ? std::string_view::npos : end - i));
+                    if (!index)
+                    {
+                        throw std::runtime_error("Expected array index in JSONPath");
+                    }
+                    segments.push_back(PathIndex{index.value()});
+                    i = end;
+                }
+
+                if (i >= path.size() || path[i] != ']')
+                {
+                    throw std::runtime_error("Missing closing ] in JSONPath");
+                }
+                ++i;
+            }
+            else
+            {
+                throw std::runtime_error("Unsupported JSONPath syntax");
+            }
+        }
+
+        return JsonPath(segments);
+    }
+
+    std::vector<std::reference_wrapper<const JsonValue>> JsonPath::evaluate(const JsonValue &root) const
+    {
+        auto out = std::vector<std::reference_wrapper<const JsonValue>>();
+        evaluate_segments(root, this->m_segments, 0, out);
+        return out;
+    }
+
+    std::vector<JsonValue> JsonPath::extract(std::string_view json_str) const
+    {
+        return extract_segments(json_str, this->m_segments, std::numeric_limits<std::size_t>::max());
+    }
+
+    PathMatcher PathMatcher::compile(const std::vector<JsonPointer> &pointers)
+    {
+        auto matcher = PathMatcher();
+        matcher.m_nodes.emplace_back();
+        matcher.m_size = pointers.size();
+
+        for (std::size_t query = 0; query < pointers.size(); ++query)
+        {
+            std::size_t node = 0;
+            ++matcher.m_nodes[node].query_count;
+
+            for (const auto &segment : pointers[query].segments())
+            {
+                const auto &token = std::get<PathToken>(segment).token;
+
+                auto &members = matcher.m_nodes[node].members;
+                auto it = std::lower_bound(members.begin(), members.end(), token, [](const auto &edge, const auto &name)
+                                           { return edge.first < name; });
+                if (it != members.end() && it->first == token)
+                {
+                    node = it->second;
+                }
+                else
+                {
+                    auto child = matcher.m_nodes.size();
+                    members.insert(it, {token, child});
+                    if (auto index = parse_array_index(token))
+                    {
+                        auto &indices = matcher.m_nodes[node].indices;
+                        indices.insert(std::upper_bound(indices.begin(), indices.end(), std::make_pair(index.value(), child)), {index.value(), child});
+                    }
+                    matcher.m_nodes.emplace_back();
+                    node = child;
+                }
+
+                ++matcher.m_nodes[node].query_count;
+            }
+
+            matcher.m_nodes[node].queries.push_back(query);
+        }
+
+        return matcher;
+    }
+
+    std::optional<std::size_t> PathMatcher::find_member(std::size_t node, std::string_view name) const
+    {
+        const auto &members = this->m_nodes[node].members;
+        auto it = std::lower_bound(members.begin(), members.end(), name, [](const auto &edge, const auto &name)
+                                   { return std::string_view(edge.first) < name; });
+        if (it == members.end() || it->first != name)
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<std::size_t> PathMatcher::find_index(std::size_t node, std::size_t index) const
+    {
+        const auto &indices = this->m_nodes[node].indices;
+        auto it = std::lower_bound(indices.begin(), indices.end(), index, [](const auto &edge, auto index)
+                                   { return edge.first < index; });
+        if (it == indices.end() || it->first != index)
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void PathMatcher::resolve(std::size_t node, const JsonValue &value, std::vector<std::optional<JsonValue>> &results) const
+    {
+        for (auto query : this->m_nodes[node].queries)
+        {
+            results[query] = value;
+        }
+
+        auto inner = value.value();
+        if (!inner)
+        {
+            return;
+        }
+
+        if (auto object = std::get_if<JsonObject>(&inner->get()))
+        {
+            for (const auto &[name, child] : this->m_nodes[node].members)
+            {
+                if (auto it = object->find(name); it != object->end())
+                {
+                    this->resolve(child, it->second, results);
+                }
+            }
+        }
+        else if (auto array = std::get_if<JsonArray>(&inner->get()))
+        {
+            for (const auto &[index, child] : this->m_nodes[node].indices)
+            {
+                if (index < array->size())
+                {
+                    this->resolve(child, (*array)[index], results);
+                }
+            }
+        }
+    }
+
+    template <typename Resolve>
+    void PathMatcher::walk(std::string_view json_str, Resolve &&resolve) const
+    {
+        // Pointers that are still unresolved at or below each node.
+        auto unresolved = std::vector<std::size_t>();
+        unresolved.reserve(this->m_nodes.size());
+        for (const auto &node : this->m_nodes)
+        {
+            unresolved.push_back(node.query_count);
+        }
+
+        struct Open
+        {
+            std::size_t node;
+            // Next array index.
+            std::size_t index;
+            // Offset of the opening bracket.
+            std::size_t start;
+        };
+
+        // One entry per open container that lies on a compiled path.
+        auto stack = std::vector<Open>();
+        auto tokenizer = scan::Tokenizer(json_str);
+
+        auto mark_resolved = [&](std::size_t node)
+        {
+            auto count = unresolved[node];
+            unresolved[node] = 0;
+            for (auto &open : stack)
+            {
+                unresolved[open.node] -= count;
+            }
+        };
+
+        auto visit = [&](std::size_t node, const scan::Token &token)
+        {
+            auto container = token.type == scan::BeginObject || token.type == scan::BeginArray;
+            if (unresolved[node] == 0)
+            {
+                tokenizer.span(token);
+            }
+            else if (container && unresolved[node] > this->m_nodes[node].queries.size())
+            {
+                // Pointers below this one still need to be found, so the container is scanned and
+                // resolved itself once it closes.
+                stack.push_back({node, 0, token.offset});
+            }
+            else
+            {
+                auto text = tokenizer.span(token);
+                if (!this->m_nodes[node].queries.empty())
+                {
+                    resolve(node, text);
+                }
+                mark_resolved(node);
+            }
+        };
+
+        visit(0, tokenizer.next());
+        while (!stack.empty() && unresolved[0] > 0)
+        {
+            auto node = stack.back().node;
+            if (unresolved[node] == 0)
+            {
+                tokenizer.skip();
+                stack.pop_back();
+                continue;
+            }
+
+            auto token = tokenizer.next();
+            if (token.type == scan::EndObject || token.type == scan::EndArray)
+            {
+                if (!this->m_nodes[node].queries.empty())
+                {
+                    auto start = stack.back().start;
+                    resolve(node, json_str.substr(start, token.offset + 1 - start));
+                }
+                stack.pop_back();
+                mark_resolved(node);
+            }
+            else if (token.type == scan::Key)
+            {
+                auto value = tokenizer.next();
+                if (auto child = this->find_member(node, token.text))
+                {
+                    visit(child.value(), value);
+                }
+                else
+                {
+                    tokenizer.span(value);
+                }
+            }
+            else
+            {
+                if (auto child = this->find_index(node, stack.back().index++))
+                {
+                    visit(child.value(), token);
+                }
+                else
+                {
+                    tokenizer.span(token);
+                }
+            }
+        }
+    }
+
+    std::vector<std::optional<JsonValue>> PathMatcher::extract(std::string_view json_str) const
+    {
+        auto results = std::vector<std::optional<JsonValue>>(this->m_size);
+        // A container that was scanned for deeper pointers is parsed once it closes, and resolve
+        // fills in everything below it again from that value.
+        this->walk(json_str, [&](std::size_t node, std::string_view text)
+                   { this->resolve(node, JsonValue::parse(text), results); });
+        return results;
+    }
+
+    std::vector<std::optional<std::string_view>> PathMatcher::locate(std::string_view json_str) const
+    {
+        auto results = std::vector<std::optional<std::string_view>>(this->m_size);
+        this->walk(json_str, [&](std::size_t node, std::string_view text)
+                   {
+                       for (auto query : this->m_nodes[node].queries)
+                       {
+                           results[query] = text;
+                       } });
+        return results;
+    }
+
+}
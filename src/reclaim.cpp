@@ -0,0 +1,77 @@
+#include "reclaim.hpp"
+
+#include <utility>
+
+namespace jsonpp::reclaim
+{
+
+    Reclaimer::Reclaimer() : m_thread([this]
+                                      { this->run(); }) {}
+
+    Reclaimer::~Reclaimer()
+    {
+        {
+            auto lock = std::lock_guard<std::mutex>(this->m_mutex);
+            this->m_stop = true;
+        }
+        this->m_wake.notify_one();
+        this->m_thread.join();
+    }
+
+    void Reclaimer::dispose(JsonValue value)
+    {
+        auto inner = value.value();
+        if (!inner)
+        {
+            return;
+        }
+        auto object = std::get_if<JsonObject>(&inner->get());
+        auto array = std::get_if<JsonArray>(&inner->get());
+        auto numbers = std::get_if<JsonNumberArray>(&inner->get());
+        if (!(object && !object->empty()) && !(array && !array->empty()) && !(numbers && !numbers->empty()))
+        {
+            return;
+        }
+
+        {
+            auto lock = std::lock_guard<std::mutex>(this->m_mutex);
+            this->m_queue.push_back(std::move(value));
+        }
+        this->m_wake.notify_one();
+    }
+
+    void Reclaimer::flush()
+    {
+        auto lock = std::unique_lock<std::mutex>(this->m_mutex);
+        this->m_idle.wait(lock, [this]
+                          { return this->m_queue.empty() && !this->m_busy; });
+    }
+
+    void Reclaimer::run()
+    {
+        auto batch = std::vector<JsonValue>();
+        auto lock = std::unique_lock<std::mutex>(this->m_mutex);
+        while (1)
+        {
+            this->m_wake.wait(lock, [this]
+                              { return this->m_stop || !this->m_queue.empty(); });
+            if (this->m_queue.empty())
+            {
+                // Only stopping once the queue is drained.
+                return;
+            }
+
+            batch.swap(this->m_queue);
+            this->m_busy = true;
+            lock.unlock();
+            batch.clear();
+            lock.lock();
+            this->m_busy = false;
+            if (this->m_queue.empty())
+            {
+                this->m_idle.notify_all();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,327 @@
+#include "scanner.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+#include "lexer.hpp"
+#include "state.hpp"
+
+namespace jsonpp::scan
+{
+
+    namespace
+    {
+
+        /**
+         * Compares the whole literal at once. The length is a compile time constant, so this is a
+         * single 4 or 5 byte comparison.
+         */
+        template <StateExactType ExactType>
+        bool matches_literal(std::string_view input, std::size_t pos)
+        {
+            constexpr auto length = StateExact<ExactType>::length();
+            return input.size() - pos >= length && std::memcmp(input.data() + pos, StateExact<ExactType>::match(), length) == 0;
+        }
+
+    }
+
+    Token Tokenizer::next()
+    {
+        while (1)
+        {
+            this->skip_whitespace();
+
+            if (this->m_stack.empty())
+            {
+                if (this->m_done)
+                {
+                    if (this->m_pos < this->m_input.size())
+                    {
+                        throw std::runtime_error("Extraneous input after JSON");
+                    }
+                    return Token{End, std::string_view(), this->m_pos};
+                }
+                if (this->m_pos >= this->m_input.size())
+                {
+                    throw std::runtime_error("Unexpected end of input in JSON value");
+                }
+                return this->read_value();
+            }
+
+            auto &frame = this->m_stack.back();
+            if (this->m_pos >= this->m_input.size())
+            {
+                throw std::runtime_error(frame.object ? "Missing closing } on JSON object" : "Missing closing ] on JSON array");
+            }
+
+            auto c = this->m_input[this->m_pos];
+            switch (frame.expect)
+            {
+            case ExpectValueOrEnd:
+                if (c == ']')
+                {
+                    return this->close(EndArray);
+                }
+                frame.expect = ExpectCommaOrEnd;
+                return this->read_value();
+            case ExpectValue:
+                frame.expect = ExpectCommaOrEnd;
+                return this->read_value();
+            case ExpectCommaOrEnd:
+                if (c == (frame.object ? '}' : ']'))
+                {
+                    return this->close(frame.object ? EndObject : EndArray);
+                }
+                if (c != ',')
+                {
+                    throw std::runtime_error("Expected comma");
+                }
+                ++this->m_pos;
+                frame.expect = frame.object ? ExpectKey : ExpectValue;
+                break;
+            case ExpectKeyOrEnd:
+                if (c == '}')
+                {
+                    return this->close(EndObject);
+                }
+                [[fallthrough]];
+            case ExpectKey:
+                if (c != '"')
+                {
+                    throw std::runtime_error("Expected start of key");
+                }
+                frame.expect = ExpectColon;
+                return this->read_string(Key);
+            case ExpectColon:
+                if (c != ':')
+                {
+                    throw std::runtime_error("Expected colon");
+                }
+                ++this->m_pos;
+                frame.expect = ExpectValue;
+                break;
+            }
+        }
+    }
+
+    void Tokenizer::skip()
+    {
+        if (this->m_stack.empty())
+        {
+            return;
+        }
+
+        // Closing brackets of the containers being skipped, innermost last, so a bracket of the
+        // wrong kind is caught.
+        auto closers = std::string(1, this->m_stack.back().object ? '}' : ']');
+        while (this->m_pos < this->m_input.size())
+        {
+            auto c = this->m_input[this->m_pos];
+            switch (c)
+            {
+            case '"':
+                this->skip_string();
+                continue;
+            case '{':
+                closers.push_back('}');
+                break;
+            case '[':
+                closers.push_back(']');
+                break;
+            case '}':
+            case ']':
+                if (c != closers.back())
+                {
+                    throw std::runtime_error(closers.back() == '}' ? "Missing closing } on JSON object" : "Missing closing ] on JSON array");
+                }
+                closers.pop_back();
+                if (closers.empty())
+                {
+                    ++this->m_pos;
+                    this->m_stack.pop_back();
+                    this->m_done = this->m_stack.empty();
+                    return;
+                }
+                break;
+            }
+            ++this->m_pos;
+        }
+
+        throw std::runtime_error(this->m_stack.back().object ? "Missing closing } on JSON object" : "Missing closing ] on JSON array");
+    }
+
+    std::string_view Tokenizer::skip_value()
+    {
+        return this->span(this->next());
+    }
+
+    std::string_view Tokenizer::span(const Token &token)
+    {
+        if (token.type == BeginObject || token.type == BeginArray)
+        {
+            this->skip();
+        }
+        return this->m_input.substr(token.offset, this->m_pos - token.offset);
+    }
+
+    Token Tokenizer::read_value()
+    {
+        auto c = this->m_input[this->m_pos];
+        switch (c)
+        {
+        case '{':
+            this->m_stack.push_back(Frame{true, ExpectKeyOrEnd});
+            return Token{BeginObject, this->m_input.substr(this->m_pos++, 1), this->m_pos - 1};
+        case '[':
+            this->m_stack.push_back(Frame{false, ExpectValueOrEnd});
+            return Token{BeginArray, this->m_input.substr(this->m_pos++, 1), this->m_pos - 1};
+        case '"':
+            this->m_done = this->m_stack.empty();
+            return this->read_string(String);
+        case 't':
+        case 'f':
+        case 'n':
+            this->m_done = this->m_stack.empty();
+            return this->read_literal();
+        default:
+            if (lex::next_number_state(lex::NumberStart, c) == lex::NumberInvalid)
+            {
+                throw std::runtime_error("Invalid JSON value");
+            }
+            this->m_done = this->m_stack.empty();
+            return this->read_number();
+        }
+    }
+
+    Token Tokenizer::read_string(TokenType type)
+    {
+        auto start = this->m_pos;
+        this->skip_string();
+        return Token{type, this->m_input.substr(start + 1, this->m_pos - start - 2), start};
+    }
+
+    Token Tokenizer::read_number()
+    {
+        auto start = this->m_pos;
+        auto state = lex::NumberStart;
+        auto end = start;
+        for (; end < this->m_input.size(); ++end)
+        {
+            auto next = lex::next_number_state(state, this->m_input[end]);
+            if (next == lex::NumberEnd)
+            {
+                break;
+            }
+            if (next == lex::NumberInvalid)
+            {
+                throw std::runtime_error("Invalid character");
+            }
+            state = next;
+        }
+        if (!lex::number_accepting(state))
+        {
+            throw std::runtime_error("Unexpected end of input in JSON number");
+        }
+
+        this->m_pos = end;
+        return Token{Number, this->m_input.substr(start, end - start), start};
+    }
+
+    Token Tokenizer::read_literal()
+    {
+        auto start = this->m_pos;
+        std::string_view literal;
+        bool matched;
+        switch (this->m_input[start])
+        {
+        case 't':
+            literal = StateExact<True>::match();
+            matched = matches_literal<True>(this->m_input, start);
+            break;
+        case 'f':
+            literal = StateExact<False>::match();
+            matched = matches_literal<False>(this->m_input, start);
+            break;
+        default:
+            literal = StateExact<Null>::match();
+            matched = matches_literal<Null>(this->m_input, start);
+            break;
+        }
+
+        if (!matched)
+        {
+            throw std::runtime_error(std::string("Invalid JSON literal, expected ") + std::string(literal));
+        }
+
+        this->m_pos += literal.size();
+        return Token{Literal, this->m_input.substr(start, literal.size()), start};
+    }
+
+    Token Tokenizer::close(TokenType type)
+    {
+        auto start = this->m_pos++;
+        this->m_stack.pop_back();
+        this->m_done = this->m_stack.empty();
+        return Token{type, this->m_input.substr(start, 1), start};
+    }
+
+    void Tokenizer::skip_whitespace()
+    {
+        while (this->m_pos < this->m_input.size() && lex::is_whitespace(this->m_input[this->m_pos]))
+        {
+            ++this->m_pos;
+        }
+    }
+
+    void Tokenizer::skip_string()
+    {
+        // m_pos is on the opening quote.
+        auto i = this->m_pos + 1;
+        while (1)
+        {
+            i = this->m_input.find_first_of("\"\\", i);
+            if (i == std::string_view::npos)
+            {
+                throw std::runtime_error("Missing closing \" on JSON string");
+            }
+            if (this->m_input[i] == '"')
+            {
+                this->m_pos = i + 1;
+                return;
+            }
+
+            if (i + 1 >= this->m_input.size())
+            {
+                throw std::runtime_error("Missing closing \" on JSON string");
+            }
+            switch (this->m_input[i + 1])
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                i += 2;
+                break;
+            case 'u':
+                for (auto j = i + 2; j < i + 6; ++j)
+                {
+                    if (j >= this->m_input.size() || !lex::is_hex(this->m_input[j]))
+                    {
+                        throw std::runtime_error("Invalid hex digit in unicode escaped sequence in JSON string");
+                    }
+                }
+                i += 6;
+                break;
+            default:
+                throw std::runtime_error("Invalid escape sequence in JSON string");
+            }
+        }
+    }
+
+}
@@ -0,0 +1,566 @@
+#include "schema.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "lexer.hpp"
+#include "scanner.hpp"
+#include "utils.hpp"
+
+namespace jsonpp::schema
+{
+
+    namespace
+    {
+
+        // Bits of Schema::Node::enum_literals.
+        constexpr unsigned EnumNull = 1;
+        constexpr unsigned EnumFalse = 2;
+        constexpr unsigned EnumTrue = 4;
+
+        [[noreturn]] void malformed(const std::string &keyword)
+        {
+            throw std::runtime_error("Malformed JSON Schema keyword \"" + keyword + "\"");
+        }
+
+        bool is_annotation(const std::string &keyword)
+        {
+            return keyword == "$schema" || keyword == "$id" || keyword == "$comment" || keyword == "title" || keyword == "description" || keyword == "default" || keyword == "examples";
+        }
+
+        const JsonObject *as_object(const JsonValue &value)
+        {
+            auto inner = value.value();
+            return inner ? std::get_if<JsonObject>(&inner->get()) : nullptr;
+        }
+
+        double as_number(const std::string &keyword, const JsonValue &value)
+        {
+            auto inner = value.value();
+            auto d = inner ? std::get_if<double>(&inner->get()) : nullptr;
+            if (!d)
+            {
+                malformed(keyword);
+            }
+            return *d;
+        }
+
+        /**
+         * @return the elements of an array value, boxing a packed one.
+         */
+        JsonArray as_array(const std::string &keyword, const JsonValue &value)
+        {
+            auto inner = value.value();
+            if (inner)
+            {
+                if (auto a = std::get_if<JsonArray>(&inner->get()))
+                {
+                    return *a;
+                }
+                if (auto a = std::get_if<JsonNumberArray>(&inner->get()))
+                {
+                    return JsonArray(a->begin(), a->end());
+                }
+            }
+            malformed(keyword);
+        }
+
+        /**
+         * Counts the code points of a string as written in the document: an escape is one code
+         * point, and so is an escaped surrogate pair.
+         */
+        std::size_t code_points(std::string_view raw)
+        {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < raw.size(); ++count)
+            {
+                if (raw[i] != '\\')
+                {
+                    // Skip UTF-8 continuation bytes.
+                    ++i;
+                    while (i < raw.size() && (static_cast<unsigned char>(raw[i]) & 0xc0) == 0x80)
+                    {
+                        ++i;
+                    }
+                }
+                else if (i + 1 == raw.size() || raw[i + 1] != 'u')
+                {
+                    i += 2;
+                }
+                else
+                {
+                    auto high = raw.substr(i + 2, 2);
+                    auto surrogate = high.size() == 2 && (high[0] == 'd' || high[0] == 'D') && std::string_view("89abAB").find(high[1]) != std::string_view::npos;
+                    i += surrogate && raw.substr(i + 6, 2) == "\\u" ? 12 : 6;
+                }
+            }
+            return count;
+        }
+
+        [[noreturn]] void violation(const std::string &reason)
+        {
+            throw std::runtime_error("JSON document does not match the schema: " + reason);
+        }
+
+    }
+
+    Schema Schema::compile(const JsonValue &schema)
+    {
+        auto compiled = Schema();
+        compiled.m_nodes.emplace_back();
+        compiled.m_root = compiled.add(schema);
+        return compiled;
+    }
+
+    std::size_t Schema::add(const JsonValue &schema)
+    {
+        auto inner = schema.value();
+        if (inner)
+        {
+            if (auto b = std::get_if<bool>(&inner->get()))
+            {
+                if (*b)
+                {
+                    return 0;
+                }
+                auto node = Node();
+                node.types = 0;
+                this->m_nodes.push_back(std::move(node));
+                return this->m_nodes.size() - 1;
+            }
+        }
+        auto object = as_object(schema);
+        if (!object)
+        {
+            throw std::runtime_error("JSON Schema must be an object or a boolean");
+        }
+
+        // Subschemas are added while this one is built, so it is only stored at the end.
+        auto index = this->m_nodes.size();
+        this->m_nodes.emplace_back();
+        auto node = Node();
+        auto type_bit = [](const JsonValue &name) -> unsigned
+        {
+            auto inner = name.value();
+            auto s = inner ? std::get_if<std::string>(&inner->get()) : nullptr;
+            if (s)
+            {
+                for (auto [type, bit] : {std::pair<const char *, Type>{"null", NullType}, {"boolean", BooleanType}, {"object", ObjectType}, {"array", ArrayType}, {"number", NumberType}, {"string", StringType}, {"integer", IntegerType}})
+                {
+                    if (*s == type)
+                    {
+                        return bit;
+                    }
+                }
+            }
+            malformed("type");
+        };
+        auto member = [&node](const std::string &name) -> Member &
+        {
+            for (auto &m : node.members)
+            {
+                if (m.name == name)
+                {
+                    return m;
+                }
+            }
+            return node.members.emplace_back(Member{name, 0, false});
+        };
+
+        for (const auto &[keyword, value] : *object)
+        {
+            if (keyword == "type")
+            {
+                auto v = value.value();
+                if (v && std::holds_alternative<JsonArray>(v->get()))
+                {
+                    node.types = 0;
+                    for (const auto &type : std::get<JsonArray>(v->get()))
+                    {
+                        node.types |= type_bit(type);
+                    }
+                }
+                else
+                {
+                    node.types = type_bit(value);
+                }
+            }
+            else if (keyword == "properties")
+            {
+                auto properties = as_object(value);
+                if (!properties)
+                {
+                    malformed(keyword);
+                }
+                for (const auto &[name, subschema] : *properties)
+                {
+                    auto sub = this->add(subschema);
+                    member(name).node = sub;
+                }
+            }
+            else if (keyword == "required")
+            {
+                for (const auto &name : as_array(keyword, value))
+                {
+                    auto v = name.value();
+                    auto s = v ? std::get_if<std::string>(&v->get()) : nullptr;
+                    if (!s)
+                    {
+                        malformed(keyword);
+                    }
+                    member(*s).required = true;
+                }
+            }
+            else if (keyword == "items")
+            {
+                node.items = this->add(value);
+            }
+            else if (keyword == "enum")
+            {
+                node.has_enum = true;
+                for (const auto &element : as_array(keyword, value))
+                {
+                    auto v = element.value();
+                    if (!v)
+                    {
+                        node.enum_literals |= EnumNull;
+                    }
+                    else if (auto b = std::get_if<bool>(&v->get()))
+                    {
+                        node.enum_literals |= *b ? EnumTrue : EnumFalse;
+                    }
+                    else if (auto d = std::get_if<double>(&v->get()))
+                    {
+                        node.enum_numbers.push_back(*d);
+                    }
+                    else if (auto s = std::get_if<std::string>(&v->get()))
+                    {
+                        node.enum_strings.push_back(*s);
+                    }
+                    else
+                    {
+                        throw std::runtime_error("Only scalar JSON Schema enum values are supported");
+                    }
+                }
+            }
+            else if (keyword == "minimum")
+            {
+                node.minimum = as_number(keyword, value);
+            }
+            else if (keyword == "maximum")
+            {
+                node.maximum = as_number(keyword, value);
+            }
+            else if (keyword == "maxLength")
+            {
+                auto d = as_number(keyword, value);
+                if (d < 0 || d != std::floor(d))
+                {
+                    malformed(keyword);
+                }
+                node.max_length = static_cast<std::size_t>(d);
+            }
+            else if (!is_annotation(keyword))
+            {
+                throw std::runtime_error("Unsupported JSON Schema keyword \"" + keyword + "\"");
+            }
+        }
+
+        std::sort(node.members.begin(), node.members.end(), [](const Member &a, const Member &b)
+                  { return a.name < b.name; });
+        node.required = std::count_if(node.members.begin(), node.members.end(), [](const Member &m)
+                                      { return m.required; });
+        this->m_nodes[index] = std::move(node);
+        return index;
+    }
+
+    void Schema::scan(std::string_view json_str) const
+    {
+        Validator(*this).scan(json_str);
+    }
+
+    void Schema::validate(const JsonValue &value) const
+    {
+        Validator(*this).value(value);
+    }
+
+    std::size_t Validator::start_value(unsigned type)
+    {
+        auto index = this->m_schema.m_root;
+        if (!this->m_stack.empty())
+        {
+            const auto &top = this->m_stack.back();
+            index = top.object ? top.next : this->m_schema.m_nodes[top.node].items;
+        }
+        if (!(this->m_schema.m_nodes[index].types & type))
+        {
+            violation("value has a type the schema does not allow");
+        }
+        return index;
+    }
+
+    void Validator::begin_object()
+    {
+        auto index = this->start_value(Schema::ObjectType);
+        const auto &node = this->m_schema.m_nodes[index];
+        if (node.has_enum)
+        {
+            violation("object is not one of the enum values");
+        }
+        this->m_stack.push_back(Frame{index, true, this->m_seen.size(), 0, 0});
+        this->m_seen.resize(this->m_seen.size() + node.members.size(), 0);
+    }
+
+    void Validator::key(std::string_view key)
+    {
+        auto &top = this->m_stack.back();
+        const auto &members = this->m_schema.m_nodes[top.node].members;
+        auto it = std::lower_bound(members.begin(), members.end(), key, [](const Schema::Member &m, std::string_view key)
+                                   { return m.name < key; });
+        if (it == members.end() || it->name != key)
+        {
+            top.next = 0;
+            return;
+        }
+
+        top.next = it->node;
+        auto &seen = this->m_seen[top.seen + (it - members.begin())];
+        if (it->required && !seen)
+        {
+            ++top.required_seen;
+        }
+        seen = 1;
+    }
+
+    void Validator::end_object()
+    {
+        const auto &top = this->m_stack.back();
+        const auto &node = this->m_schema.m_nodes[top.node];
+        if (top.required_seen < node.required)
+        {
+            for (std::size_t i = 0; i < node.members.size(); ++i)
+            {
+                if (node.members[i].required && !this->m_seen[top.seen + i])
+                {
+                    violation("object is missing required member \"" + node.members[i].name + "\"");
+                }
+            }
+        }
+        this->m_seen.resize(top.seen);
+        this->m_stack.pop_back();
+    }
+
+    void Validator::begin_array()
+    {
+        auto index = this->start_value(Schema::ArrayType);
+        if (this->m_schema.m_nodes[index].has_enum)
+        {
+            violation("array is not one of the enum values");
+        }
+        this->m_stack.push_back(Frame{index, false, this->m_seen.size(), 0, 0});
+    }
+
+    void Validator::end_array()
+    {
+        this->m_stack.pop_back();
+    }
+
+    void Validator::string(std::string_view raw)
+    {
+        const auto &node = this->m_schema.m_nodes[this->start_value(Schema::StringType)];
+        if (node.max_length && code_points(raw) > *node.max_length)
+        {
+            violation("string is longer than maxLength");
+        }
+        if (node.has_enum && std::find(node.enum_strings.begin(), node.enum_strings.end(), raw) == node.enum_strings.end())
+        {
+            violation("string is not one of the enum values");
+        }
+    }
+
+    void Validator::number(double d)
+    {
+        unsigned type = Schema::NumberType;
+        if (std::isfinite(d) && d == std::floor(d))
+        {
+            type |= Schema::IntegerType;
+        }
+        const auto &node = this->m_schema.m_nodes[this->start_value(type)];
+        if (node.minimum && d < *node.minimum)
+        {
+            violation("number is less than minimum");
+        }
+        if (node.maximum && d > *node.maximum)
+        {
+            violation("number is greater than maximum");
+        }
+        if (node.has_enum && std::find(node.enum_numbers.begin(), node.enum_numbers.end(), d) == node.enum_numbers.end())
+        {
+            violation("number is not one of the enum values");
+        }
+    }
+
+    void Validator::boolean(bool b)
+    {
+        const auto &node = this->m_schema.m_nodes[this->start_value(Schema::BooleanType)];
+        if (node.has_enum && !(node.enum_literals & (b ? EnumTrue : EnumFalse)))
+        {
+            violation("boolean is not one of the enum values");
+        }
+    }
+
+    void Validator::null()
+    {
+        const auto &node = this->m_schema.m_nodes[this->start_value(Schema::NullType)];
+        if (node.has_enum && !(node.enum_literals & EnumNull))
+        {
+            violation("null is not one of the enum values");
+        }
+    }
+
+    void Validator::value(const JsonValue &value)
+    {
+        // Containers still being fed, kept on an explicit stack so deep values cannot overflow the
+        // call stack.
+        struct ObjectFrame
+        {
+            JsonObject::const_iterator it;
+            JsonObject::const_iterator end;
+        };
+        struct ArrayFrame
+        {
+            JsonArray::const_iterator it;
+            JsonArray::const_iterator end;
+        };
+        auto stack = std::vector<std::variant<ObjectFrame, ArrayFrame>>();
+
+        auto next = &value;
+        while (1)
+        {
+            if (next)
+            {
+                auto inner = next->value();
+                next = nullptr;
+                if (!inner)
+                {
+                    this->null();
+                }
+                else
+                {
+                    std::visit(utils::inline_visitor{
+                                   [this, &stack](const JsonObject &o)
+                                   {
+                                       this->begin_object();
+                                       stack.push_back(ObjectFrame{o.begin(), o.end()});
+                                   },
+                                   [this, &stack](const JsonArray &a)
+                                   {
+                                       this->begin_array();
+                                       stack.push_back(ArrayFrame{a.begin(), a.end()});
+                                   },
+                                   [this](const std::string &s)
+                                   { this->string(s); },
+                                   [this](const double &d)
+                                   { this->number(d); },
+                                   [this](const bool &b)
+                                   { this->boolean(b); },
+                                   [this](const JsonNumberArray &a)
+                                   {
+                                       this->begin_array();
+                                       for (auto d : a)
+                                       {
+                                           this->number(d);
+                                       }
+                                       this->end_array();
+                                   },
+                                   [this](const JsonRaw &r)
+                                   { this->scan(r.text); },
+                               },
+                               inner->get());
+                }
+            }
+
+            if (stack.empty())
+            {
+                return;
+            }
+            next = std::visit(utils::inline_visitor{
+                                  [this](ObjectFrame &frame) -> const JsonValue *
+                                  {
+                                      if (frame.it == frame.end)
+                                      {
+                                          this->end_object();
+                                          return nullptr;
+                                      }
+                                      const auto &[key, member] = *frame.it++;
+                                      this->key(key);
+                                      return &member;
+                                  },
+                                  [this](ArrayFrame &frame) -> const JsonValue *
+                                  {
+                                      if (frame.it == frame.end)
+                                      {
+                                          this->end_array();
+                                          return nullptr;
+                                      }
+                                      return &*frame.it++;
+                                  },
+                              },
+                              stack.back());
+            if (!next)
+            {
+                stack.pop_back();
+            }
+        }
+    }
+
+    void Validator::scan(std::string_view json_str)
+    {
+        auto tokenizer = jsonpp::scan::Tokenizer(json_str);
+        while (1)
+        {
+            auto token = tokenizer.next();
+            switch (token.type)
+            {
+            case jsonpp::scan::BeginObject:
+                this->begin_object();
+                break;
+            case jsonpp::scan::EndObject:
+                this->end_object();
+                break;
+            case jsonpp::scan::BeginArray:
+                this->begin_array();
+                break;
+            case jsonpp::scan::EndArray:
+                this->end_array();
+                break;
+            case jsonpp::scan::Key:
+                this->key(token.text);
+                break;
+            case jsonpp::scan::String:
+                this->string(token.text);
+                break;
+            case jsonpp::scan::Number:
+                this->number(lex::to_double(token.text));
+                break;
+            case jsonpp::scan::Literal:
+                if (token.text == "null")
+                {
+                    this->null();
+                }
+                else
+                {
+                    this->boolean(token.text == "true");
+                }
+                break;
+            case jsonpp::scan::End:
+                return;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,260 @@
+#include "serialize.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "utils.hpp"
+
+namespace jsonpp::serialize
+{
+
+    namespace
+    {
+
+        long write_fd(int fd, const char *data, std::size_t size)
+        {
+#ifdef _WIN32
+            return _write(fd, data, static_cast<unsigned>(std::min<std::size_t>(size, 1u << 30)));
+#else
+            return ::write(fd, data, size);
+#endif
+        }
+
+    }
+
+    Serializer::Serializer(const JsonValue &value, Sink sink, std::size_t buffer_size)
+        : m_value(value), m_sink(std::move(sink)), m_capacity(buffer_size)
+    {
+        if (buffer_size == 0)
+        {
+            throw std::runtime_error("Serializer needs a buffer of at least one byte");
+        }
+        this->m_buffer.reserve(buffer_size);
+    }
+
+    bool Serializer::write()
+    {
+        while (1)
+        {
+            auto full = this->m_buffer.size() == this->m_capacity;
+            if ((full || this->m_finished) && !this->drain())
+            {
+                return false;
+            }
+            if (this->m_finished)
+            {
+                return true;
+            }
+
+            while (this->m_buffer.size() < this->m_capacity && !this->m_finished)
+            {
+                if (this->m_piece == this->m_pieces.size())
+                {
+                    this->m_pieces.clear();
+                    this->m_piece = 0;
+                    this->next_token();
+                    continue;
+                }
+
+                // Pieces longer than the buffer, like long strings, are copied over several fills.
+                auto &piece = this->m_pieces[this->m_piece];
+                auto n = std::min(piece.size(), this->m_capacity - this->m_buffer.size());
+                this->m_buffer.append(piece.data(), n);
+                piece.remove_prefix(n);
+                if (piece.empty())
+                {
+                    ++this->m_piece;
+                }
+            }
+        }
+    }
+
+    bool Serializer::drain()
+    {
+        auto chunk = std::string_view(this->m_buffer).substr(this->m_offset);
+        if (!chunk.empty())
+        {
+            this->m_offset += std::min(this->m_sink(chunk), chunk.size());
+            if (this->m_offset < this->m_buffer.size())
+            {
+                return false;
+            }
+        }
+        this->m_buffer.clear();
+        this->m_offset = 0;
+        return true;
+    }
+
+    void Serializer::next_token()
+    {
+        if (this->m_stack.empty())
+        {
+            if (this->m_started)
+            {
+                this->m_finished = true;
+                return;
+            }
+            this->m_started = true;
+            this->start_value(this->m_value);
+            return;
+        }
+
+        // start_value may push onto the stack, which can move the frame being visited, so every
+        // frame is updated before it is called.
+        std::visit(utils::inline_visitor{
+                       [this](ObjectFrame &frame)
+                       {
+                           if (frame.it == frame.end)
+                           {
+                               this->m_pieces.push_back("}");
+                               this->m_stack.pop_back();
+                               return;
+                           }
+                           const auto &[key, value] = *frame.it++;
+                           this->m_pieces.push_back(frame.first ? "\"" : ",\"");
+                           frame.first = false;
+                           this->m_pieces.push_back(key);
+                           this->m_pieces.push_back("\":");
+                           this->start_value(value);
+                       },
+                       [this](ArrayFrame &frame)
+                       {
+                           if (frame.index == frame.elements->size())
+                           {
+                               this->m_pieces.push_back("]");
+                               this->m_stack.pop_back();
+                               return;
+                           }
+                           if (frame.index > 0)
+                           {
+                               this->m_pieces.push_back(",");
+                           }
+                           this->start_value((*frame.elements)[frame.index++]);
+                       },
+                       [this](NumbersFrame &frame)
+                       {
+                           if (frame.index == frame.numbers->size())
+                           {
+                               this->m_pieces.push_back("]");
+                               this->m_stack.pop_back();
+                               return;
+                           }
+                           if (frame.index > 0)
+                           {
+                               this->m_pieces.push_back(",");
+                           }
+                           this->number((*frame.numbers)[frame.index++]);
+                       },
+                   },
+                   this->m_stack.back());
+    }
+
+    void Serializer::start_value(const JsonValue &value)
+    {
+        auto inner = value.value();
+        if (!inner)
+        {
+            this->m_pieces.push_back("null");
+            return;
+        }
+
+        std::visit(utils::inline_visitor{
+                       [this](const JsonObject &o)
+                       {
+                           this->m_pieces.push_back("{");
+                           this->m_stack.push_back(ObjectFrame{o.begin(), o.end(), true});
+                       },
+                       [this](const JsonArray &a)
+                       {
+                           this->m_pieces.push_back("[");
+                           this->m_stack.push_back(ArrayFrame{&a, 0});
+                       },
+                       [this](const std::string &s)
+                       {
+                           this->m_pieces.push_back("\"");
+                           this->m_pieces.push_back(s);
+                           this->m_pieces.push_back("\"");
+                       },
+                       [this](const double &d)
+                       { this->number(d); },
+                       [this](const bool &b)
+                       { this->m_pieces.push_back(b ? "true" : "false"); },
+                       [this](const JsonNumberArray &a)
+                       {
+                           this->m_pieces.push_back("[");
+                           this->m_stack.push_back(NumbersFrame{&a, 0});
+                       },
+                       [this](const JsonRaw &r)
+                       { this->m_pieces.push_back(r.text); },
+                   },
+                   inner->get());
+    }
+
+    void Serializer::number(double d)
+    {
+        // Like ToJsonVisitor. A token holds at most one number, so m_number is free again by the
+        // time the next one is written.
+        if (!std::isfinite(d))
+        {
+            this->m_pieces.push_back("null");
+            return;
+        }
+        auto res = std::to_chars(this->m_number.data(), this->m_number.data() + this->m_number.size(), d);
+        this->m_pieces.push_back(std::string_view(this->m_number.data(), res.ptr - this->m_number.data()));
+    }
+
+    void write(const JsonValue &value, std::ostream &out, std::size_t buffer_size)
+    {
+        auto serializer = Serializer(
+            value,
+            [&out](std::string_view chunk)
+            {
+                out.write(chunk.data(), chunk.size());
+                if (!out)
+                {
+                    throw std::runtime_error("Failed to write JSON to stream");
+                }
+                return chunk.size();
+            },
+            buffer_size);
+        serializer.write();
+    }
+
+    void write(const JsonValue &value, int fd, std::size_t buffer_size)
+    {
+        auto serializer = Serializer(
+            value,
+            [fd](std::string_view chunk)
+            {
+                std::size_t written = 0;
+                while (written < chunk.size())
+                {
+                    auto n = write_fd(fd, chunk.data() + written, chunk.size() - written);
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        throw std::runtime_error(std::string("Failed to write JSON: ") + std::strerror(errno));
+                    }
+                    written += static_cast<std::size_t>(n);
+                }
+                return written;
+            },
+            buffer_size);
+        serializer.write();
+    }
+
+}
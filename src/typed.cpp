@@ -0,0 +1,56 @@
+#include "typed.hpp"
+
+#include "scanner.hpp"
+
+namespace jsonpp::typed
+{
+
+    // Tokens are converted with a cast, so every enumerator must have the same value in both.
+    static_assert(static_cast<int>(scan::BeginObject) == BeginObject &&
+                      static_cast<int>(scan::EndObject) == EndObject &&
+                      static_cast<int>(scan::BeginArray) == BeginArray &&
+                      static_cast<int>(scan::EndArray) == EndArray &&
+                      static_cast<int>(scan::Key) == Key &&
+                      static_cast<int>(scan::String) == String &&
+                      static_cast<int>(scan::Number) == Number &&
+                      static_cast<int>(scan::Literal) == Literal &&
+                      static_cast<int>(scan::End) == End,
+                  "typed::TokenType must list the token types in the same order as scan::TokenType");
+
+    struct Input::Impl
+    {
+        scan::Tokenizer tokenizer;
+    };
+
+    Input::Input(std::string_view json_str) : m_impl(std::make_unique<Impl>(Impl{scan::Tokenizer(json_str)})) {}
+
+    Input::~Input() = default;
+
+    Token Input::next()
+    {
+        auto token = this->m_impl->tokenizer.next();
+        return Token{static_cast<TokenType>(token.type), token.text, token.offset};
+    }
+
+    std::string_view Input::span(const Token &token)
+    {
+        return this->m_impl->tokenizer.span(scan::Token{static_cast<scan::TokenType>(token.type), token.text, token.offset});
+    }
+
+    void Input::skip(const Token &token)
+    {
+        if (token.type != BeginObject && token.type != BeginArray)
+        {
+            return;
+        }
+
+        // The container is open, so reading stops at the token that closes it.
+        auto &tokenizer = this->m_impl->tokenizer;
+        auto depth = tokenizer.depth();
+        while (tokenizer.depth() >= depth)
+        {
+            tokenizer.next();
+        }
+    }
+
+}
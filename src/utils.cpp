@@ -4,6 +4,11 @@ namespace jsonpp::utils
 {
     std::string join(std::vector<std::string> &elems, char delimiter)
     {
+        if (elems.empty())
+        {
+            return std::string();
+        }
+
         size_t needed = elems.size() - 1; // For the delimiters
         for (auto &e : elems)
         {
@@ -0,0 +1,104 @@
+#ifdef __cpp_impl_coroutine
+
+#include "gtest/gtest.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "async.hpp"
+#include "lib.hpp"
+#include "test_utils.hpp"
+
+/**
+ * Hands out chunks one at a time, suspending on every read until the test plays reactor and resumes
+ * the reader.
+ */
+class ChunkSource
+{
+public:
+    struct Read
+    {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { this->source->m_waiting.push_back(handle); }
+        std::string await_resume()
+        {
+            auto chunk = std::move(this->source->m_chunks.front());
+            this->source->m_chunks.pop_front();
+            return chunk;
+        }
+
+        ChunkSource *source;
+    };
+
+    explicit ChunkSource(std::deque<std::string> chunks) : m_chunks(std::move(chunks)) {}
+
+    Read next() { return Read{this}; }
+
+    /**
+     * Completes the pending read, if any.
+     */
+    bool deliver()
+    {
+        if (this->m_waiting.empty())
+        {
+            return false;
+        }
+        auto handle = this->m_waiting.front();
+        this->m_waiting.erase(this->m_waiting.begin());
+        handle.resume();
+        return true;
+    }
+
+private:
+    std::deque<std::string> m_chunks;
+    std::vector<std::coroutine_handle<>> m_waiting;
+};
+
+static jsonpp::async::Task<std::string> parse_and_serialize(ChunkSource &source)
+{
+    auto value = co_await jsonpp::async::parse(source);
+    co_return value.json();
+}
+
+TEST(AsyncTest, ParseSuspendsBetweenChunks)
+{
+    auto source = ChunkSource({"{\"a\": [1, \"x", "y\"], \"b\"", ": tr", "ue}", ""});
+    auto task = jsonpp::async::parse(source);
+    task.start();
+
+    std::size_t reads = 0;
+    while (!task.done())
+    {
+        ASSERT_TRUE(source.deliver());
+        ++reads;
+    }
+    ASSERT_EQ(reads, 5);
+    assert_value_eq(task.get(), jsonpp::JsonValue::parse(std::string("{\"a\": [1, \"xy\"], \"b\": true}")));
+};
+
+TEST(AsyncTest, AwaitFromCoroutine)
+{
+    auto source = ChunkSource({"[1, ", "2]", ""});
+    auto task = parse_and_serialize(source);
+    task.start();
+    while (source.deliver())
+    {
+    }
+    ASSERT_TRUE(task.done());
+    ASSERT_EQ(task.get(), "[1,2]");
+};
+
+TEST(AsyncTest, ParseErrors)
+{
+    auto source = ChunkSource({"[1, ", "}", ""});
+    auto task = jsonpp::async::parse(source);
+    task.start();
+    while (source.deliver())
+    {
+    }
+    ASSERT_TRUE(task.done());
+    ASSERT_THROW(task.get(), std::runtime_error);
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache.hpp"
+#include "lib.hpp"
+#include "test_utils.hpp"
+
+TEST(CacheTest, HitsShareDocuments)
+{
+    auto cache = jsonpp::cache::ParseCache();
+    auto json = std::string("{\"a\": [1, 2], \"b\": \"x\"}");
+
+    auto first = cache.parse(json);
+    auto second = cache.parse(std::string(json));
+    ASSERT_TRUE(first.shares(second));
+    assert_value_eq(first, jsonpp::JsonValue::parse(json));
+    ASSERT_FALSE(cache.parse("{\"a\": [1, 2], \"b\": \"y\"}").shares(first));
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.entries, 2);
+    ASSERT_GT(stats.bytes, 2 * json.size());
+
+    // Changing a returned value leaves the cached document alone.
+    std::get<jsonpp::JsonObject>(second.mutable_value()->get()).erase("a");
+    assert_value_eq(cache.parse(json), jsonpp::JsonValue::parse(json));
+
+    ASSERT_THROW(cache.parse("[1,"), std::runtime_error);
+    ASSERT_EQ(cache.stats().entries, 2);
+
+    cache.clear();
+    ASSERT_EQ(cache.stats().entries, 0);
+    ASSERT_EQ(cache.stats().bytes, 0);
+    ASSERT_TRUE(first.equals(jsonpp::JsonValue::parse(json)));
+
+    // Sizing a document does not recurse, however deep it is.
+    auto deep = std::string(50000, '[') + std::string(50000, ']');
+    ASSERT_EQ(cache.parse(deep).json(), deep);
+    ASSERT_EQ(cache.stats().entries, 1);
+};
+
+TEST(CacheTest, EvictsLeastRecentlyUsed)
+{
+    auto options = jsonpp::cache::CacheOptions{};
+    options.shards = 1;
+    options.max_bytes = 1000;
+    auto cache = jsonpp::cache::ParseCache(options);
+
+    auto documents = std::vector<std::string>();
+    for (int i = 0; i < 20; ++i)
+    {
+        documents.push_back("[" + std::to_string(i) + "]");
+    }
+
+    auto kept = cache.parse(documents[0]);
+    for (const auto &document : documents)
+    {
+        cache.parse(document);
+        // Keep the first document in use.
+        ASSERT_TRUE(cache.parse(documents[0]).shares(kept));
+    }
+
+    auto stats = cache.stats();
+    ASSERT_GT(stats.evictions, 0);
+    ASSERT_LE(stats.bytes, options.max_bytes);
+    ASSERT_EQ(stats.entries + stats.evictions, documents.size());
+
+    // Too large for the cache on its own.
+    ASSERT_NO_THROW(cache.parse("\"" + std::string(2000, 'x') + "\""));
+    ASSERT_EQ(cache.stats().entries, stats.entries);
+
+    options.shards = 0;
+    ASSERT_THROW(jsonpp::cache::ParseCache{options}, std::runtime_error);
+};
+
+TEST(CacheTest, ConcurrentLookups)
+{
+    auto options = jsonpp::cache::CacheOptions{};
+    options.shards = 4;
+    auto cache = jsonpp::cache::ParseCache(options);
+
+    auto documents = std::vector<std::string>();
+    for (int i = 0; i < 50; ++i)
+    {
+        documents.push_back("{\"id\": " + std::to_string(i) + ", \"tags\": [\"a\", \"b\"]}");
+    }
+
+    auto threads = std::vector<std::thread>();
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&]
+                             {
+                                 for (int round = 0; round < 20; ++round)
+                                 {
+                                     for (const auto &document : documents)
+                                     {
+                                         auto value = cache.parse(document);
+                                         value.hash();
+                                     }
+                                 } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.entries, documents.size());
+    ASSERT_EQ(stats.hits + stats.misses, 8 * 20 * documents.size());
+    for (const auto &document : documents)
+    {
+        ASSERT_TRUE(cache.parse(document).equals(jsonpp::JsonValue::parse(document)));
+    }
+};
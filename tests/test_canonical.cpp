@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+
+#include "canonical.hpp"
+#include "lib.hpp"
+
+static std::string canonical(const char *json)
+{
+    return jsonpp::canonical::serialize(jsonpp::JsonValue::parse(std::string(json)));
+}
+
+static std::string hex(const jsonpp::canonical::Digest &digest)
+{
+    static const char *digits = "0123456789abcdef";
+    auto out = std::string();
+    for (auto byte : digest)
+    {
+        out.push_back(digits[byte >> 4]);
+        out.push_back(digits[byte & 0xf]);
+    }
+    return out;
+}
+
+TEST(CanonicalTest, Numbers)
+{
+    ASSERT_EQ(canonical("[0, -0, 1, -1.5, 4.50, 2e-3, 1e-6, 1e-7, 1.5e-7, 1e20, 1e21, 1e30, 333333333.3333333, 123456789012345680000]"),
+              "[0,0,1,-1.5,4.5,0.002,0.000001,1e-7,1.5e-7,100000000000000000000,1e+21,1e+30,333333333.3333333,123456789012345680000]");
+    ASSERT_THROW(jsonpp::canonical::serialize(jsonpp::JsonValue(1.0 / 0.0)), std::runtime_error);
+};
+
+TEST(CanonicalTest, Strings)
+{
+    ASSERT_EQ(canonical("\"\\u20ac$\\u000F\\u000aA'\\u0042\\u0022\\u005c\\\\\\\"\\/\""), "\"\xe2\x82\xac$\\u000f\\nA'B\\\"\\\\\\\\\\\"/\"");
+    ASSERT_EQ(canonical("\"\\ud83d\\ude00\""), "\"\xf0\x9f\x98\x80\"");
+    ASSERT_THROW(canonical("\"\\ud83d\""), std::runtime_error);
+
+    // Overlong forms, encoded surrogates and code points past U+10FFFF.
+    ASSERT_THROW(canonical("\"\xc0\xaf\""), std::runtime_error);
+    ASSERT_THROW(canonical("\"\xe0\x80\xaf\""), std::runtime_error);
+    ASSERT_THROW(canonical("\"\xf0\x80\x80\xaf\""), std::runtime_error);
+    ASSERT_THROW(canonical("\"\xed\xa0\x80\""), std::runtime_error);
+    ASSERT_THROW(canonical("\"\xf4\x90\x80\x80\""), std::runtime_error);
+    ASSERT_EQ(canonical("\"\xed\x9f\xbf\xf4\x8f\xbf\xbf\""), "\"\xed\x9f\xbf\xf4\x8f\xbf\xbf\"");
+};
+
+TEST(CanonicalTest, DeepNesting)
+{
+    // Deep enough to overflow the stack if writing recursed.
+    auto depth = 40000;
+    auto json = std::string();
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "{\"a\":[";
+    }
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "]}";
+    }
+    ASSERT_EQ(canonical(json.c_str()), json);
+
+    // Raw values are written like the values they hold.
+    auto options = jsonpp::ParseOptions{};
+    options.raw_pointers = {"/a"};
+    ASSERT_EQ(jsonpp::canonical::serialize(jsonpp::JsonValue::parse(json, options)), json);
+};
+
+TEST(CanonicalTest, SortsKeys)
+{
+    ASSERT_EQ(canonical("{\"\\u20ac\": 5, \"\\r\": 1, \"\\ufb33\": 7, \"1\": 2, \"\\ud83d\\ude00\": 6, \"\\u0080\": 3, \"\\u00f6\": 4}"),
+              "{\"\\r\":1,\"1\":2,\"\xc2\x80\":3,\"\xc3\xb6\":4,\"\xe2\x82\xac\":5,\"\xf0\x9f\x98\x80\":6,\"\xef\xac\xb3\":7}");
+    ASSERT_EQ(canonical("{\"b\": [1, {\"z\": null, \"y\": true}], \"a\": {}}"), "{\"a\":{},\"b\":[1,{\"y\":true,\"z\":null}]}");
+};
+
+TEST(CanonicalTest, Digest)
+{
+    ASSERT_EQ(hex(jsonpp::canonical::digest(jsonpp::JsonValue(jsonpp::JsonObject()))), "44136fa355b3678a1146ad16f7e8649e94fb4fc21fe77e8310c060f61caaff8a");
+    ASSERT_EQ(hex(jsonpp::canonical::digest(jsonpp::JsonValue::parse(std::string("{ \"b\": [1.0, \"x\"], \"a\": true }")))),
+              "654427f8ddece654ee0bf1dba626b0dfc326497be50eaef4e31006bdc495703e");
+
+    // Streaming in chunks produces the same bytes as building the string.
+    auto json = std::string("[");
+    for (int i = 0; i < 2000; ++i)
+    {
+        json += (i ? ",{\"k\": " : "{\"k\": ") + std::to_string(i) + ", \"a\": \"v\"}";
+    }
+    json += "]";
+    auto value = jsonpp::JsonValue::parse(json);
+    auto streamed = std::string();
+    std::size_t chunks = 0;
+    jsonpp::canonical::serialize(value, [&](std::string_view chunk)
+                                 { streamed.append(chunk); ++chunks; });
+    ASSERT_EQ(streamed, jsonpp::canonical::serialize(value));
+    ASSERT_GT(chunks, 1);
+};
+
+TEST(CanonicalTest, PackedNumberArrays)
+{
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+    auto json = std::string("{\"b\": [1e3, -0, 0.1], \"a\": []}");
+    ASSERT_EQ(jsonpp::canonical::serialize(jsonpp::JsonValue::parse(json, options)), "{\"a\":[],\"b\":[1000,0,0.1]}");
+};
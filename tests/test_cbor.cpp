@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include "lib.hpp"
+#include "cbor.hpp"
+#include "test_utils.hpp"
+
+static const char *DOCUMENT = "{\"a\": [0, -1, 23, 24, 1000000, 1.5, 0.1, -0.0, 1e300], \
+                                \"b\": {\"s\": \"esc\\\"aped\", \"t\": true, \"f\": false, \"n\": null}, \
+                                \"c\": []}";
+
+TEST(CborTest, EncodeScalars)
+{
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(nullptr)), (std::vector<std::uint8_t>{0xf6}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(true)), (std::vector<std::uint8_t>{0xf5}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(10.)), (std::vector<std::uint8_t>{0x0a}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(-500.)), (std::vector<std::uint8_t>{0x39, 0x01, 0xf3}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(1.5)), (std::vector<std::uint8_t>{0xfa, 0x3f, 0xc0, 0x00, 0x00}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(std::string("ab"))), (std::vector<std::uint8_t>{0x62, 'a', 'b'}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(1.)})), (std::vector<std::uint8_t>{0x81, 0x01}));
+
+    // Like json(), NaN and infinity become null.
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(INFINITY)), (std::vector<std::uint8_t>{0xf6}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(-INFINITY)), (std::vector<std::uint8_t>{0xf6}));
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue(NAN)), (std::vector<std::uint8_t>{0xf6}));
+};
+
+TEST(CborTest, RoundTrip)
+{
+    auto value = jsonpp::JsonValue::parse(DOCUMENT);
+    assert_value_eq(jsonpp::cbor::decode(jsonpp::cbor::encode(value)), value);
+};
+
+TEST(CborTest, Transcode)
+{
+    assert_value_eq(jsonpp::cbor::decode(jsonpp::cbor::transcode(DOCUMENT)), jsonpp::JsonValue::parse(DOCUMENT));
+    ASSERT_EQ(jsonpp::cbor::transcode("[1, {}]"), (std::vector<std::uint8_t>{0x9f, 0x01, 0xbf, 0xff, 0xff}));
+    ASSERT_ANY_THROW(jsonpp::cbor::transcode("[1, }"));
+
+    // Raw control characters are accepted by parse but come back escaped.
+    ASSERT_EQ(jsonpp::cbor::decode(jsonpp::cbor::transcode("[\"a\x01\"]")).json(), "[\"a\\u0001\"]");
+};
+
+TEST(CborTest, DecodeOtherEncodings)
+{
+    // Half float 1.0, tagged integer and an indefinite-length text string.
+    assert_value_eq(jsonpp::cbor::decode({0xf9, 0x3c, 0x00}), jsonpp::JsonValue(1.));
+    assert_value_eq(jsonpp::cbor::decode({0xc1, 0x1a, 0x00, 0x01, 0x00, 0x00}), jsonpp::JsonValue(65536.));
+    assert_value_eq(jsonpp::cbor::decode({0x7f, 0x61, 'a', 0x61, 'b', 0xff}), jsonpp::JsonValue(std::string("ab")));
+};
+
+TEST(CborTest, DecodeInvalid)
+{
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0x82, 0x01}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0x41, 0x00}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0xa1, 0x01, 0x02}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0x01, 0x02}));
+
+    // NaN and infinity in every float width.
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0xf9, 0x7e, 0x00}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0xfa, 0x7f, 0x80, 0x00, 0x00}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0xfb, 0xff, 0xf0, 0, 0, 0, 0, 0, 0}));
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0x62, '\\', 'x'}));
+};
+
+TEST(CborTest, DecodeText)
+{
+    // Quotes and control characters are escaped, escapes are kept.
+    ASSERT_EQ(jsonpp::cbor::decode({0x63, 'a', '"', 'b'}).json(), "\"a\\\"b\"");
+    ASSERT_EQ(jsonpp::cbor::decode({0x62, 'a', '\n'}).json(), "\"a\\u000a\"");
+    ASSERT_EQ(jsonpp::cbor::decode({0x66, '\\', 'u', '0', '0', 'e', '9'}).json(), "\"\\u00e9\"");
+    ASSERT_ANY_THROW(jsonpp::cbor::decode({0x63, '\\', 'u', '0'}));
+};
+
+TEST(CborTest, DecodeDeepNesting)
+{
+    // Deeper than the call stack could take if decoding recursed.
+    auto depth = 200000;
+    auto data = std::vector<std::uint8_t>(depth, 0x81);
+    data.push_back(0xf6);
+    auto value = jsonpp::cbor::decode(data);
+    ASSERT_EQ(value.json().size(), 2 * depth + 4);
+
+    auto options = jsonpp::ParseOptions{};
+    options.max_depth = 100;
+    ASSERT_THROW(jsonpp::cbor::decode(data, options), std::runtime_error);
+    data.pop_back();
+    ASSERT_THROW(jsonpp::cbor::decode(data), std::runtime_error);
+
+    // Encoding does not recurse either.
+    data.push_back(0xf6);
+    ASSERT_EQ(jsonpp::cbor::encode(value), data);
+
+    // Chains of tags do not recurse either.
+    auto tags = std::vector<std::uint8_t>(depth, 0xc1);
+    tags.push_back(0x01);
+    assert_value_eq(jsonpp::cbor::decode(tags), jsonpp::JsonValue(1.));
+};
+
+TEST(CborTest, PackedNumberArrays)
+{
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+    auto json = std::string("[1, 2.5, -3]");
+    ASSERT_EQ(jsonpp::cbor::encode(jsonpp::JsonValue::parse(json, options)), jsonpp::cbor::encode(jsonpp::JsonValue::parse(json)));
+};
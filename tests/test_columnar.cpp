@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+
+#include "columnar.hpp"
+#include "lib.hpp"
+
+static const char *RECORDS = "[{\"id\": 1, \"name\": \"a\\\"b\", \"ok\": true, \"tags\": [1, {\"id\": 9}]},"
+                             " {\"id\": 2.5, \"name\": \"\", \"ok\": false},"
+                             " {\"ok\": null, \"extra\": {}, \"id\": -3e2, \"name\": \"cd\"},"
+                             " {}]";
+
+static const std::vector<jsonpp::columnar::ColumnSpec> COLUMNS = {
+    {"id", jsonpp::columnar::NumberType},
+    {"name", jsonpp::columnar::StringType},
+    {"ok", jsonpp::columnar::BoolType},
+};
+
+static void assert_records(const jsonpp::columnar::Table &table)
+{
+    ASSERT_EQ(table.rows, 4);
+    ASSERT_EQ(table.columns.size(), 3);
+
+    const auto &id = table.columns[0];
+    ASSERT_EQ(std::get<jsonpp::columnar::NumberColumn>(id.values).values, std::vector<double>({1, 2.5, -300, 0}));
+    ASSERT_EQ(id.valid, std::vector<std::uint8_t>({1, 1, 1, 0}));
+
+    const auto &name = std::get<jsonpp::columnar::StringColumn>(table.columns[1].values);
+    ASSERT_EQ(name.at(0), "a\\\"b");
+    ASSERT_EQ(name.at(1), "");
+    ASSERT_EQ(name.at(2), "cd");
+    ASSERT_EQ(name.at(3), "");
+    ASSERT_EQ(table.columns[1].valid, std::vector<std::uint8_t>({1, 1, 1, 0}));
+
+    const auto &ok = table.columns[2];
+    ASSERT_EQ(std::get<jsonpp::columnar::BoolColumn>(ok.values).values, std::vector<std::uint8_t>({1, 0, 0, 0}));
+    ASSERT_EQ(ok.valid, std::vector<std::uint8_t>({1, 1, 0, 0}));
+}
+
+TEST(ColumnarTest, ExtractText)
+{
+    assert_records(jsonpp::columnar::extract(RECORDS, COLUMNS));
+};
+
+TEST(ColumnarTest, PivotValue)
+{
+    assert_records(jsonpp::columnar::pivot(jsonpp::JsonValue::parse(RECORDS), COLUMNS));
+};
+
+TEST(ColumnarTest, FirstDuplicateWins)
+{
+    auto table = jsonpp::columnar::extract(std::string_view("[{\"id\": 1, \"id\": 2}, {\"id\": null, \"id\": 3}]"), COLUMNS);
+    ASSERT_EQ(std::get<jsonpp::columnar::NumberColumn>(table.columns[0].values).values, std::vector<double>({1, 0}));
+    ASSERT_EQ(table.columns[0].valid, std::vector<std::uint8_t>({1, 0}));
+};
+
+TEST(ColumnarTest, Errors)
+{
+    for (auto json : {"{}", "[1]", "[{\"id\": \"1\"}]", "[{\"name\": 1}]", "[{\"ok\": [true]}]", "[{\"id\": 1}", "[] 1", "[{\"x\":[1}, \"a\":1}]"})
+    {
+        ASSERT_THROW(jsonpp::columnar::extract(std::string_view(json), COLUMNS), std::runtime_error) << json;
+    }
+    for (auto json : {"{}", "[1]", "[{\"id\": \"1\"}]", "[{\"name\": 1}]", "[{\"ok\": [true]}]"})
+    {
+        ASSERT_THROW(jsonpp::columnar::pivot(jsonpp::JsonValue::parse(json), COLUMNS), std::runtime_error) << json;
+    }
+};
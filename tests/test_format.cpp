@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+
+#include "format.hpp"
+#include "lib.hpp"
+
+static const char *DOCUMENT = " { \"a\" : [ 1 , -2.5e3 , { } , [ ] ] ,\n\t\"b \\\" {[,:\" : { \"c\" : null , \"d\" : true } } ";
+
+TEST(FormatTest, Minify)
+{
+    ASSERT_EQ(jsonpp::format::minify(DOCUMENT), "{\"a\":[1,-2.5e3,{},[]],\"b \\\" {[,:\":{\"c\":null,\"d\":true}}");
+    ASSERT_EQ(jsonpp::format::minify(" 12 "), "12");
+};
+
+TEST(FormatTest, Pretty)
+{
+    ASSERT_EQ(jsonpp::format::pretty(DOCUMENT, "  "),
+              "{\n"
+              "  \"a\": [\n"
+              "    1,\n"
+              "    -2.5e3,\n"
+              "    {},\n"
+              "    []\n"
+              "  ],\n"
+              "  \"b \\\" {[,:\": {\n"
+              "    \"c\": null,\n"
+              "    \"d\": true\n"
+              "  }\n"
+              "}");
+};
+
+TEST(FormatTest, ChunkedFeed)
+{
+    auto expected = jsonpp::format::pretty(DOCUMENT, "\t");
+
+    // Every split point, including inside strings, escapes and numbers.
+    auto document = std::string_view(DOCUMENT);
+    for (std::size_t split = 0; split <= document.size(); ++split)
+    {
+        auto out = std::string();
+        auto formatter = jsonpp::format::Formatter(jsonpp::format::FormatOptions{true, "\t"}, [&out](std::string_view chunk)
+                                                   { out.append(chunk); });
+        formatter.feed(document.substr(0, split));
+        formatter.feed(document.substr(split));
+        formatter.finish();
+        ASSERT_EQ(out, expected);
+    }
+
+    ASSERT_EQ(jsonpp::JsonValue::parse(jsonpp::format::minify(DOCUMENT)).json(), jsonpp::JsonValue::parse(std::string(DOCUMENT)).json());
+};
+
+TEST(FormatTest, Malformed)
+{
+    ASSERT_THROW(jsonpp::format::minify("[1, 2}"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("{\"a\": [1]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("\"abc"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("[1] [2]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("[1, :2]"), std::runtime_error);
+
+    // Missing or misplaced separators would silently change the data.
+    ASSERT_THROW(jsonpp::format::minify("[1 2]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("12 34"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("{\"a\" \"b\"}"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("[1,,2]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("[1,]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("{\"a\":1:2}"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("{\"a\"}"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("{1: 2}"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("1 [2]"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("\"a\" 1"), std::runtime_error);
+    ASSERT_THROW(jsonpp::format::minify("  "), std::runtime_error);
+};
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+
+#include "incremental.hpp"
+#include "lib.hpp"
+
+static const char *DOCUMENT = " {\"a\": [1, {\"b\": [2, 3]}, [4]], \"c\": {\"d\": \"x\"}, \"c\": [5]} ";
+
+static void assert_matches_full_parse(const jsonpp::incremental::Document &document)
+{
+    ASSERT_TRUE(document.value().equals(jsonpp::JsonValue::parse(document.text())));
+}
+
+TEST(IncrementalTest, EditReparsesEnclosingContainer)
+{
+    auto document = jsonpp::incremental::Document::parse(DOCUMENT);
+    auto before = document.value();
+
+    // Inside [2, 3].
+    document.edit(std::string_view(DOCUMENT).find("3"), 1, "30, 31");
+    ASSERT_EQ(document.parsed_bytes(), std::string("[2, 30, 31]").size());
+    assert_matches_full_parse(document);
+
+    // Spans after the first edit have moved. Inside {"d": "x"}.
+    document.edit(document.text().find("\"x\""), 3, "true");
+    ASSERT_EQ(document.parsed_bytes(), std::string("{\"d\": true}").size());
+    assert_matches_full_parse(document);
+
+    // Inside [4], a sibling after the first edit.
+    document.edit(document.text().find("4"), 0, "-");
+    ASSERT_EQ(document.parsed_bytes(), std::string("[-4]").size());
+    assert_matches_full_parse(document);
+
+    // Untouched subtrees are shared with the previous value.
+    const auto &old_object = std::get<jsonpp::JsonObject>(before.value()->get());
+    const auto &new_object = std::get<jsonpp::JsonObject>(document.value().value()->get());
+    ASSERT_FALSE(new_object.at("a").shares(old_object.at("a")));
+    const auto &old_a = std::get<jsonpp::JsonArray>(old_object.at("a").value()->get());
+    const auto &new_a = std::get<jsonpp::JsonArray>(new_object.at("a").value()->get());
+    ASSERT_TRUE(new_a[0].shares(old_a[0]));
+    ASSERT_TRUE(before.equals(jsonpp::JsonValue::parse(DOCUMENT)));
+};
+
+TEST(IncrementalTest, FallsBackToFullParse)
+{
+    auto text = std::string(DOCUMENT);
+    auto document = jsonpp::incremental::Document::parse(text);
+
+    // Closes [2, 3] early and adds a member, which only parses as a whole.
+    document.edit(text.find("2, 3"), 4, "2], \"e\": [3");
+    ASSERT_EQ(document.parsed_bytes(), document.text().size());
+    assert_matches_full_parse(document);
+
+    // Touches the brackets of the root.
+    document.edit(document.text().size() - 2, 2, ", \"e\": 1}");
+    ASSERT_EQ(document.parsed_bytes(), document.text().size());
+    assert_matches_full_parse(document);
+
+    // Inside the duplicate "c" member that JsonValue::parse ignores.
+    document.edit(document.text().find("5"), 1, "6");
+    assert_matches_full_parse(document);
+};
+
+TEST(IncrementalTest, InvalidEditLeavesDocumentUnchanged)
+{
+    auto document = jsonpp::incremental::Document::parse(DOCUMENT);
+    ASSERT_THROW(document.edit(std::string_view(DOCUMENT).find("2"), 1, "\""), std::runtime_error);
+    ASSERT_THROW(document.edit(1, 1, ""), std::runtime_error);
+    ASSERT_THROW(document.edit(document.text().size(), 1, ""), std::runtime_error);
+    ASSERT_EQ(document.text(), DOCUMENT);
+    assert_matches_full_parse(document);
+
+    document.edit(std::string_view(DOCUMENT).find("2"), 1, "7");
+    assert_matches_full_parse(document);
+};
@@ -1,6 +1,7 @@
 #include "gtest/gtest.h"
 
 #include "lib.hpp"
+#include "test_utils.hpp"
 
 template <typename T>
 constexpr auto type_name()
@@ -24,80 +25,6 @@ constexpr auto type_name()
     return name;
 }
 
-void assert_value_eq(const jsonpp::JsonValue &actual, const jsonpp::JsonValue &expected);
-
-struct Visitor
-{
-    void operator()(const bool &actual, const bool &expected) const
-    {
-        ASSERT_EQ(actual, expected);
-    }
-
-    void operator()(const double &actual, const double &expected) const
-    {
-        ASSERT_EQ(actual, expected);
-    }
-
-    void operator()(const std::string &actual, const std::string &expected) const
-    {
-        ASSERT_EQ(actual, expected);
-    }
-
-    void operator()(const jsonpp::JsonArray &actual, const jsonpp::JsonArray &expected) const
-    {
-        ASSERT_EQ(actual.size(), expected.size());
-        for (int i = 0; i < actual.size(); ++i)
-        {
-            assert_value_eq(actual[i], expected[i]);
-        }
-    }
-
-    void operator()(const jsonpp::JsonObject &actual, const jsonpp::JsonObject &expected) const
-    {
-        ASSERT_EQ(actual.size(), expected.size());
-        for (const auto &[key, value] : actual)
-        {
-            auto it = expected.find(key);
-            ASSERT_NE(it, expected.end()) << "Actual contains key not in expected";
-            assert_value_eq(value, it->second);
-        }
-    }
-
-    template <typename T, typename U>
-    void operator()(const T &actual, const U &expected) const
-    {
-        FAIL() << "Actual (" << jsonpp::ToJsonVisitor{}(actual) << ") has different type than expected (" << jsonpp::ToJsonVisitor{}(expected) << ")";
-    }
-};
-
-void assert_variant_eq(const jsonpp::JsonValueVariant &actual, const jsonpp::JsonValueVariant &expected)
-{
-    std::visit(Visitor{}, actual, expected);
-}
-
-void assert_value_eq(const jsonpp::JsonValue &actual, const jsonpp::JsonValue &expected)
-{
-    auto expected_value = expected.value();
-    if (expected_value)
-    {
-        auto expected_variant = expected_value->get();
-        auto actual_value = actual.value();
-        if (actual_value)
-        {
-            auto actual_variant = actual_value->get();
-            assert_variant_eq(actual_variant, expected_variant);
-        }
-        else
-        {
-            FAIL() << "Expected non-null";
-        }
-    }
-    else
-    {
-        ASSERT_FALSE(actual.value().has_value()) << "Expected null";
-    }
-}
-
 TEST(LibTest, ParseNull)
 {
     assert_value_eq(jsonpp::JsonValue::parse(std::string("null")), jsonpp::JsonValue(nullptr));
@@ -118,6 +45,12 @@ TEST(LibTest, ParseNumber)
     assert_value_eq(jsonpp::JsonValue::parse(std::string("1234")), jsonpp::JsonValue(1234.));
 };
 
+TEST(LibTest, ParseSignedExponent)
+{
+    assert_value_eq(jsonpp::JsonValue::parse(std::string("-1.5e-2")), jsonpp::JsonValue(-0.015));
+    assert_value_eq(jsonpp::JsonValue::parse(std::string("2E+3")), jsonpp::JsonValue(2000.));
+};
+
 TEST(LibTest, ParseString)
 {
     assert_value_eq(jsonpp::JsonValue::parse(std::string("\"Hello, world!\"")), jsonpp::JsonValue(std::string("Hello, world!")));
@@ -157,4 +90,357 @@ TEST(LibTest, ParseStressTest)
 TEST(LibTest, InvalidLiteral)
 {
     ASSERT_ANY_THROW(jsonpp::JsonValue::parse("tttt"));
-};
\ No newline at end of file
+};
+
+TEST(LibTest, TrailingComma)
+{
+    ASSERT_ANY_THROW(jsonpp::JsonValue::parse("[1,]"));
+    ASSERT_ANY_THROW(jsonpp::JsonValue::parse("{\"a\": 1,}"));
+    ASSERT_ANY_THROW(jsonpp::JsonValue::parse("[,]"));
+};
+
+TEST(LibTest, SerializeRoundTrip)
+{
+    auto value = jsonpp::JsonValue::parse(std::string("{\"a\": [true, false, null, 0.1, -2e-7, 1e300], \"b\": {\"c\": \"d\\\"e\"}}"));
+    assert_value_eq(jsonpp::JsonValue::parse(value.json()), value);
+    ASSERT_EQ(jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(true), jsonpp::JsonValue(12.5)}).json(), "[true,12.5]");
+    ASSERT_EQ(jsonpp::JsonValue(jsonpp::JsonObject{{"k", jsonpp::JsonValue(nullptr)}}).json(), "{\"k\":null}");
+    ASSERT_EQ(jsonpp::JsonValue::parse(std::string("{\"a\": [], \"b\": {}}")).json().size(), 15);
+};
+
+TEST(LibTest, ParseStats)
+{
+    auto json = std::string("{\"key\": [1, \"a string that does not fit inline\", true]}");
+    auto stats = jsonpp::ParseStats{};
+    stats.pushes = 1000;
+    assert_value_eq(jsonpp::JsonValue::parse(json, stats), jsonpp::JsonValue::parse(json));
+
+#ifdef JSONPP_INSTRUMENTATION
+    ASSERT_EQ(stats.transitions, json.size());
+    ASSERT_EQ(stats.pushes, 10);
+    ASSERT_EQ(stats.pops, 10);
+    ASSERT_EQ(stats.max_depth, 6);
+    ASSERT_GT(stats.string_bytes, 0);
+    ASSERT_EQ(stats.number_bytes, 0);
+#else
+    ASSERT_EQ(stats.pushes, 0);
+    ASSERT_EQ(stats.transitions, 0);
+#endif
+};
+
+TEST(LibTest, ParseDeepNesting)
+{
+    auto depth = 1000;
+    auto json = std::string();
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "{\"a\": [";
+    }
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "]}";
+    }
+
+    auto value = jsonpp::JsonValue::parse(json);
+    const jsonpp::JsonValue *current = &value;
+    for (int i = 0; i < depth; ++i)
+    {
+        const auto &object = std::get<jsonpp::JsonObject>(current->value()->get());
+        const auto &array = std::get<jsonpp::JsonArray>(object.at("a").value()->get());
+        if (array.empty())
+        {
+            ASSERT_EQ(i, depth - 1);
+            break;
+        }
+        current = &array[0];
+    }
+};
+
+TEST(LibTest, DeepNestingTeardown)
+{
+    // Deep enough to overflow the stack if destruction or json() recursed.
+    auto depth = 50000;
+    auto json = std::string();
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "{\"a\":[";
+    }
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "]}";
+    }
+
+    auto value = jsonpp::JsonValue::parse(json);
+    ASSERT_EQ(value.json(), json);
+
+    // A subtree still shared with another value outlives the document.
+    const jsonpp::JsonValue *current = &value;
+    for (int i = 0; i < depth / 2; ++i)
+    {
+        const auto &object = std::get<jsonpp::JsonObject>(current->value()->get());
+        current = &std::get<jsonpp::JsonArray>(object.at("a").value()->get())[0];
+    }
+    auto shared = *current;
+    value = nullptr;
+    ASSERT_EQ(shared.json(), json.substr(depth / 2 * 6, json.size() - depth / 2 * 8));
+}
+
+TEST(LibTest, ParseLimits)
+{
+    auto json = std::string("{\"a\": [[1, 2, 3], \"four\"], \"b\": {}}");
+
+    auto options = jsonpp::ParseOptions{};
+    assert_value_eq(jsonpp::JsonValue::parse(json, options), jsonpp::JsonValue::parse(json));
+
+    options.max_depth = 3;
+    assert_value_eq(jsonpp::JsonValue::parse(json, options), jsonpp::JsonValue::parse(json));
+    options.max_depth = 2;
+    ASSERT_THROW(jsonpp::JsonValue::parse(json, options), std::runtime_error);
+
+    options = jsonpp::ParseOptions{};
+    options.max_document_size = json.size() - 1;
+    ASSERT_THROW(jsonpp::JsonValue::parse(json, options), std::runtime_error);
+
+    options = jsonpp::ParseOptions{};
+    options.max_string_length = 3;
+    ASSERT_THROW(jsonpp::JsonValue::parse(json, options), std::runtime_error);
+    options.max_string_length = 4;
+    jsonpp::JsonValue::parse(json, options);
+
+    options = jsonpp::ParseOptions{};
+    options.max_elements = 2;
+    ASSERT_THROW(jsonpp::JsonValue::parse(json, options), std::runtime_error);
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("{\"a\": 1, \"b\": 2, \"c\": 3}"), options), std::runtime_error);
+
+    options = jsonpp::ParseOptions{};
+    options.max_allocation = 10 * sizeof(jsonpp::JsonValue);
+    ASSERT_THROW(jsonpp::JsonValue::parse(json, options), std::runtime_error);
+    options.max_allocation = 100 * sizeof(jsonpp::JsonValue);
+    jsonpp::JsonValue::parse(json, options);
+};
+
+TEST(LibTest, CopyOnWrite)
+{
+    const auto original = jsonpp::JsonValue::parse(std::string("{\"a\": [1, 2], \"b\": {\"c\": true}}"));
+    auto copy = original;
+    ASSERT_TRUE(copy.shares(original));
+    ASSERT_EQ(&copy.value()->get(), &original.value()->get());
+
+    auto &object = std::get<jsonpp::JsonObject>(copy.mutable_value()->get());
+    ASSERT_FALSE(copy.shares(original));
+    ASSERT_TRUE(object.at("b").shares(std::get<jsonpp::JsonObject>(original.value()->get()).at("b")));
+
+    auto &array = std::get<jsonpp::JsonArray>(object.at("a").mutable_value()->get());
+    array.push_back(3.0);
+    ASSERT_TRUE(object.at("b").shares(std::get<jsonpp::JsonObject>(original.value()->get()).at("b")));
+
+    assert_value_eq(original, jsonpp::JsonValue::parse(std::string("{\"a\": [1, 2], \"b\": {\"c\": true}}")));
+    assert_value_eq(copy, jsonpp::JsonValue::parse(std::string("{\"a\": [1, 2, 3], \"b\": {\"c\": true}}")));
+
+    auto unique = jsonpp::JsonValue(2.0);
+    const auto *node = &unique.value()->get();
+    ASSERT_EQ(&unique.mutable_value()->get(), node);
+};
+
+TEST(LibTest, HashAndEquals)
+{
+    auto a = jsonpp::JsonValue::parse(std::string("{\"x\": [1, -0, \"s\"], \"y\": {\"z\": null}, \"w\": false}"));
+    auto b = jsonpp::JsonValue::parse(std::string("{\"w\": false, \"y\": {\"z\": null}, \"x\": [1, 0, \"s\"]}"));
+    ASSERT_TRUE(a.equals(b));
+    ASSERT_EQ(a.hash(), b.hash());
+
+    auto c = jsonpp::JsonValue::parse(std::string("{\"x\": [1, 0, \"s\"], \"y\": {\"z\": 0}, \"w\": false}"));
+    ASSERT_FALSE(a.equals(c));
+    ASSERT_NE(a.hash(), c.hash());
+    ASSERT_NE(jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(1.), jsonpp::JsonValue(2.)}).hash(),
+              jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(2.), jsonpp::JsonValue(1.)}).hash());
+
+    // Changing a copy invalidates the hashes along the changed path only.
+    auto d = a;
+    auto &object = std::get<jsonpp::JsonObject>(d.mutable_value()->get());
+    std::get<jsonpp::JsonArray>(object.at("x").mutable_value()->get()).push_back(true);
+    ASSERT_NE(d.hash(), a.hash());
+    ASSERT_FALSE(d.equals(a));
+    ASSERT_EQ(object.at("y").hash(), std::get<jsonpp::JsonObject>(b.value()->get()).at("y").hash());
+};
+
+TEST(LibTest, DeepHashAndEquals)
+{
+    // Deep enough to overflow the stack if hashing or comparing recursed.
+    auto depth = 40000;
+    auto json = std::string(depth, '[') + std::string(depth, ']');
+    auto other = std::string(depth, '[') + "1" + std::string(depth, ']');
+
+    auto a = jsonpp::JsonValue::parse(json);
+    auto b = jsonpp::JsonValue::parse(json);
+    auto c = jsonpp::JsonValue::parse(other);
+    ASSERT_EQ(a.hash(), b.hash());
+    ASSERT_NE(a.hash(), c.hash());
+    ASSERT_TRUE(a.equals(b));
+    ASSERT_FALSE(a.equals(c));
+    ASSERT_FALSE(jsonpp::JsonValue::parse(other).equals(a));
+};
+
+TEST(LibTest, ParserChunked)
+{
+    auto json = std::string("{\"a\": [1.5e3, \"x\\\"y\", true, null], \"b\": {\"c\": -0.25}}");
+    auto expected = jsonpp::JsonValue::parse(json);
+
+    for (std::size_t split = 0; split <= json.size(); ++split)
+    {
+        auto parser = jsonpp::Parser();
+        parser.feed(std::string_view(json).substr(0, split));
+        parser.feed(std::string_view(json).substr(split));
+        assert_value_eq(parser.finish(), expected);
+    }
+
+    auto options = jsonpp::ParseOptions{};
+    options.max_document_size = 4;
+    auto parser = jsonpp::Parser(options);
+    parser.feed("[1,");
+    ASSERT_THROW(parser.feed("2]"), std::runtime_error);
+
+    auto incomplete = jsonpp::Parser();
+    incomplete.feed("[1,");
+    ASSERT_THROW(incomplete.finish(), std::runtime_error);
+    ASSERT_THROW(incomplete.feed("2]"), std::runtime_error);
+};
+
+TEST(LibTest, ScalarGrammar)
+{
+    for (auto json : {"0", "-0", "12", "-1.5", "1e5", "1E+5", "0.25e-3", "\"a\\\\\"", "\"\\u00e9\"", "[\"\\\\\", \"\\\"\"]"})
+    {
+        ASSERT_NO_THROW(jsonpp::JsonValue::parse(std::string(json))) << json;
+    }
+    for (auto json : {".5", "e5", "01", "1.", "-", "1e", "1e+", "+1", "\"\\x\"", "\"\\u12g4\"", "tru", "nul"})
+    {
+        ASSERT_THROW(jsonpp::JsonValue::parse(std::string(json)), std::runtime_error) << json;
+    }
+};
+
+TEST(LibTest, PackedNumberArrays)
+{
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+
+    auto json = std::string("{\"a\": [1, -2.5e1 , 0.5], \"b\": [1, \"x\", 2], \"c\": [], \"d\": [[3], [true]]}");
+    auto packed = jsonpp::JsonValue::parse(json, options);
+    const auto &object = std::get<jsonpp::JsonObject>(packed.value()->get());
+    assert_variant_eq(object.at("a").value()->get(), jsonpp::JsonNumberArray{1, -25, 0.5});
+    ASSERT_TRUE(std::holds_alternative<jsonpp::JsonArray>(object.at("b").value()->get()));
+    ASSERT_TRUE(std::holds_alternative<jsonpp::JsonArray>(object.at("c").value()->get()));
+    const auto &d = std::get<jsonpp::JsonArray>(object.at("d").value()->get());
+    assert_variant_eq(d[0].value()->get(), jsonpp::JsonNumberArray{3});
+    ASSERT_EQ(object.at("a").json(), "[1,-25,0.5]");
+
+    // Packed and boxed arrays of the same numbers are the same value.
+    auto boxed = jsonpp::JsonValue::parse(json);
+    ASSERT_TRUE(packed.equals(boxed));
+    ASSERT_TRUE(boxed.equals(packed));
+    ASSERT_EQ(packed.hash(), boxed.hash());
+    ASSERT_FALSE(jsonpp::JsonValue::parse("[1, 2]", options).equals(jsonpp::JsonValue::parse("[1, 3]")));
+
+    // Numbers split across chunks.
+    auto parser = jsonpp::Parser(options);
+    parser.feed("[12");
+    parser.feed("3.2");
+    parser.feed("5, 4]");
+    assert_value_eq(parser.finish(), jsonpp::JsonNumberArray{123.25, 4});
+
+    for (auto invalid : {"[1.]", "[1 2]", "[01]", "[-]", "[1", "[1,"})
+    {
+        ASSERT_THROW(jsonpp::JsonValue::parse(std::string(invalid), options), std::runtime_error) << invalid;
+    }
+
+    options.max_elements = 2;
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("[1, 2, 3]"), options), std::runtime_error);
+};
+
+TEST(LibTest, SourceMap)
+{
+    auto json = std::string(" {\"a\": [1, \"x\", true, {}], \"b\": -2.5e1 , \"c\": null} ");
+    auto source_map = jsonpp::SourceMap();
+    auto value = jsonpp::JsonValue::parse(json, jsonpp::ParseOptions{}, source_map);
+
+    const auto &object = std::get<jsonpp::JsonObject>(value.value()->get());
+    const auto &a = std::get<jsonpp::JsonArray>(object.at("a").value()->get());
+    ASSERT_EQ(source_map.slice(json, value), json.substr(1, json.size() - 2));
+    ASSERT_EQ(source_map.slice(json, object.at("a")), "[1, \"x\", true, {}]");
+    ASSERT_EQ(source_map.slice(json, a[0]), "1");
+    ASSERT_EQ(source_map.slice(json, a[1]), "\"x\"");
+    ASSERT_EQ(source_map.slice(json, a[2]), "true");
+    ASSERT_EQ(source_map.slice(json, a[3]), "{}");
+    ASSERT_EQ(source_map.slice(json, object.at("b")), "-2.5e1");
+    ASSERT_FALSE(source_map.find(object.at("c")));
+    ASSERT_FALSE(source_map.find(jsonpp::JsonValue::parse(json)));
+
+    // Scalars at the end of the input, split across chunks.
+    auto parser = jsonpp::Parser(jsonpp::ParseOptions{}, source_map);
+    parser.feed(" 12");
+    parser.feed("34");
+    auto number = parser.finish();
+    ASSERT_EQ(source_map.size(), 1);
+    ASSERT_EQ(source_map.find(number)->begin, 1);
+    ASSERT_EQ(source_map.find(number)->end, 5);
+};
+
+TEST(LibTest, RawValues)
+{
+    auto json = std::string("{\"meta\": {\"id\": 7}, \"data\": [ {\"x\" : [1, 2.5e1]}, \"s\\\"\", -3 , null ], \"n\": 12}");
+    auto options = jsonpp::ParseOptions{};
+    options.raw_pointers = {"/data/0", "/data/2", "/n", "/missing/x"};
+    auto value = jsonpp::JsonValue::parse(json, options);
+
+    const auto &object = std::get<jsonpp::JsonObject>(value.value()->get());
+    const auto &data = std::get<jsonpp::JsonArray>(object.at("data").value()->get());
+    assert_variant_eq(data[0].value()->get(), jsonpp::JsonRaw{"{\"x\" : [1, 2.5e1]}"});
+    assert_variant_eq(data[1].value()->get(), std::string("s\\\""));
+    assert_variant_eq(data[2].value()->get(), jsonpp::JsonRaw{"-3"});
+    assert_variant_eq(object.at("n").value()->get(), jsonpp::JsonRaw{"12"});
+    ASSERT_TRUE(std::holds_alternative<jsonpp::JsonObject>(object.at("meta").value()->get()));
+    ASSERT_EQ(object.at("data").json(), "[{\"x\" : [1, 2.5e1]},\"s\\\"\",-3,null]");
+
+    // Raw values are the same value as the parsed ones.
+    auto parsed = jsonpp::JsonValue::parse(json);
+    ASSERT_TRUE(value.equals(parsed));
+    ASSERT_TRUE(parsed.equals(value));
+    ASSERT_EQ(value.hash(), parsed.hash());
+
+    options = jsonpp::ParseOptions{};
+    options.raw_depth = 2;
+    auto deep = jsonpp::JsonValue::parse(json, options);
+    const auto &meta = std::get<jsonpp::JsonObject>(std::get<jsonpp::JsonObject>(deep.value()->get()).at("meta").value()->get());
+    assert_variant_eq(meta.at("id").value()->get(), jsonpp::JsonRaw{"7"});
+
+    // Raw values are validated, and may be split across chunks.
+    options.raw_depth = 0;
+    for (std::size_t split = 0; split <= json.size(); ++split)
+    {
+        auto parser = jsonpp::Parser(options);
+        parser.feed(std::string_view(json).substr(0, split));
+        parser.feed(std::string_view(json).substr(split));
+        assert_value_eq(parser.finish(), jsonpp::JsonRaw{json});
+    }
+    assert_value_eq(jsonpp::JsonValue::parse(" true ", options), jsonpp::JsonRaw{"true"});
+    for (auto invalid : {"[1,]", "{\"a\" 1}", "{\"a\": 1,}", "[1 2]", "[01]", "\"\\x\"", "nul", "[1", "{\"a\": [}", "[1]]", "-"})
+    {
+        ASSERT_THROW(jsonpp::JsonValue::parse(std::string(invalid), options), std::runtime_error) << invalid;
+    }
+
+    options.max_depth = 2;
+    ASSERT_NO_THROW(jsonpp::JsonValue::parse(std::string("[[1]]"), options));
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("[[[1]]]"), options), std::runtime_error);
+
+    // So are strings and containers inside them.
+    options = jsonpp::ParseOptions{};
+    options.raw_pointers = {"/a"};
+    options.max_string_length = 4;
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":\"0123456789\"}"), options), std::runtime_error);
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":{\"01234\": 1}}"), options), std::runtime_error);
+    ASSERT_NO_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":[\"0123\", {\"\\n12\": 1}]}"), options));
+    options.max_string_length = std::numeric_limits<std::size_t>::max();
+    options.max_elements = 2;
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":[1,2,3,4]}"), options), std::runtime_error);
+    ASSERT_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":{\"x\": 1, \"y\": 2, \"z\": 3}}"), options), std::runtime_error);
+    ASSERT_NO_THROW(jsonpp::JsonValue::parse(std::string("{\"a\":[[1, 2], {\"x\": [3], \"y\": {}}]}"), options));
+};
@@ -0,0 +1,144 @@
+#include "gtest/gtest.h"
+
+#include "lib.hpp"
+#include "patch.hpp"
+#include "test_utils.hpp"
+
+static jsonpp::JsonValue parse(const char *json)
+{
+    return jsonpp::JsonValue::parse(std::string(json));
+}
+
+TEST(PatchTest, Apply)
+{
+    auto document = parse("{\"a\": {\"b\": [1, 2]}, \"c\": \"x\", \"d\": {\"e\": null}}");
+    jsonpp::patch::apply(document, parse("[ \
+        {\"op\": \"test\", \"path\": \"/c\", \"value\": \"x\"}, \
+        {\"op\": \"add\", \"path\": \"/a/b/1\", \"value\": 5}, \
+        {\"op\": \"add\", \"path\": \"/a/b/-\", \"value\": [true]}, \
+        {\"op\": \"remove\", \"path\": \"/a/b/0\"}, \
+        {\"op\": \"replace\", \"path\": \"/c\", \"value\": {\"y\": 1}}, \
+        {\"op\": \"move\", \"from\": \"/d\", \"path\": \"/c/z\"}, \
+        {\"op\": \"copy\", \"from\": \"/c/y\", \"path\": \"/f\"} \
+    ]"));
+    assert_value_eq(document, parse("{\"a\": {\"b\": [5, 2, [true]]}, \"c\": {\"y\": 1, \"z\": {\"e\": null}}, \"f\": 1}"));
+};
+
+TEST(PatchTest, ApplyIsAtomic)
+{
+    const auto original = parse("{\"a\": [1], \"b\": 2}");
+    auto document = original;
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"remove\", \"path\": \"/b\"}, {\"op\": \"test\", \"path\": \"/a/0\", \"value\": 2}]")), std::runtime_error);
+    ASSERT_TRUE(document.shares(original));
+
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"replace\", \"path\": \"/missing\", \"value\": 1}]")), std::runtime_error);
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"add\", \"path\": \"/a/2\", \"value\": 1}]")), std::runtime_error);
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"move\", \"from\": \"/a\", \"path\": \"/a/0\"}]")), std::runtime_error);
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"frobnicate\", \"path\": \"\"}]")), std::runtime_error);
+
+    // Only the patched path is copied.
+    jsonpp::patch::apply(document, parse("[{\"op\": \"replace\", \"path\": \"/b\", \"value\": 3}]"));
+    const auto &object = std::get<jsonpp::JsonObject>(document.value()->get());
+    ASSERT_TRUE(object.at("a").shares(std::get<jsonpp::JsonObject>(original.value()->get()).at("a")));
+};
+
+TEST(PatchTest, Merge)
+{
+    auto document = parse("{\"a\": \"b\", \"c\": {\"d\": \"e\", \"f\": \"g\"}, \"h\": 1}");
+    jsonpp::patch::merge(document, parse("{\"a\": \"z\", \"c\": {\"f\": null}, \"h\": {\"i\": {\"j\": null}}}"));
+    assert_value_eq(document, parse("{\"a\": \"z\", \"c\": {\"d\": \"e\"}, \"h\": {\"i\": {}}}"));
+
+    jsonpp::patch::merge(document, parse("[1]"));
+    assert_value_eq(document, parse("[1]"));
+
+    // A patch taken from the document itself is left as it was.
+    document = parse("{\"a\": {\"b\": 1}}");
+    auto inner = std::get<jsonpp::JsonObject>(document.value()->get()).at("a");
+    jsonpp::patch::merge(document, inner);
+    assert_value_eq(document, parse("{\"a\": {\"b\": 1}, \"b\": 1}"));
+    assert_value_eq(inner, parse("{\"b\": 1}"));
+
+    // Deep enough to overflow the stack if merging recursed.
+    auto deep = jsonpp::JsonValue(1.);
+    for (int i = 0; i < 300000; ++i)
+    {
+        deep = jsonpp::JsonValue(jsonpp::JsonObject{{"a", std::move(deep)}});
+    }
+    document = parse("{}");
+    jsonpp::patch::merge(document, deep);
+    ASSERT_TRUE(document.equals(deep));
+};
+
+TEST(PatchTest, Splice)
+{
+    const auto json = std::string("{\"keep\" : [ 1,2 ], \"a\": {\"b\": 1, \"c\": \"old\"}, \"z\": null}");
+
+    auto spliced = jsonpp::patch::splice(json, parse("[ \
+        {\"op\": \"replace\", \"path\": \"/a/c\", \"value\": [1, 2]}, \
+        {\"op\": \"test\", \"path\": \"/a/b\", \"value\": 1}, \
+        {\"op\": \"replace\", \"path\": \"/z\", \"value\": true}, \
+        {\"op\": \"test\", \"path\": \"/z\", \"value\": true} \
+    ]"));
+    ASSERT_EQ(spliced, "{\"keep\" : [ 1,2 ], \"a\": {\"b\": 1, \"c\": [1,2]}, \"z\": true}");
+
+    ASSERT_THROW(jsonpp::patch::splice(json, parse("[{\"op\": \"test\", \"path\": \"/a/b\", \"value\": 2}]")), std::runtime_error);
+    ASSERT_THROW(jsonpp::patch::splice(json, parse("[{\"op\": \"replace\", \"path\": \"/a/x\", \"value\": 2}]")), std::runtime_error);
+
+    // Nested paths and other operations fall back to a full parse.
+    auto patch = parse("[{\"op\": \"replace\", \"path\": \"/a\", \"value\": {}}, {\"op\": \"add\", \"path\": \"/a/b\", \"value\": 1}]");
+    auto document = parse(json.c_str());
+    jsonpp::patch::apply(document, patch);
+    assert_value_eq(parse(jsonpp::patch::splice(json, patch).c_str()), document);
+};
+
+TEST(PatchTest, Diff)
+{
+    auto from = parse("{\"same\": {\"x\": [1, 2]}, \"a/b\": 1, \"gone\": true, \"list\": [1, 2, 3], \"short\": [1], \"kind\": \"s\"}");
+    auto to = parse("{\"same\": {\"x\": [1, 2]}, \"a/b\": 2, \"new\": null, \"list\": [1, 5], \"short\": [1, {}, 3], \"kind\": {}}");
+
+    auto patch = jsonpp::patch::diff(from, to);
+    ASSERT_EQ(std::get<jsonpp::JsonArray>(patch.value()->get()).size(), 8);
+    jsonpp::patch::apply(from, patch);
+    ASSERT_TRUE(from.equals(to));
+
+    assert_value_eq(jsonpp::patch::diff(to, to), parse("[]"));
+    assert_value_eq(jsonpp::patch::diff(parse("[1]"), parse("{}")), parse("[{\"op\": \"replace\", \"path\": \"\", \"value\": {}}]"));
+
+    // Deep documents are diffed without recursion.
+    auto depth = 40000;
+    auto deep_from = jsonpp::JsonValue::parse(std::string(depth, '[') + std::string(depth, ']'));
+    auto deep_to = jsonpp::JsonValue::parse(std::string(depth, '[') + "1" + std::string(depth, ']'));
+    auto deep_patch = jsonpp::patch::diff(deep_from, deep_to);
+    const auto &operations = std::get<jsonpp::JsonArray>(deep_patch.value()->get());
+    ASSERT_EQ(operations.size(), 1);
+    ASSERT_EQ(operations[0].json().size(), std::string("{\"op\":\"add\",\"path\":\"\",\"value\":1}").size() + 2 * depth);
+};
+
+TEST(PatchTest, PackedNumberArrays)
+{
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+    auto packed = jsonpp::JsonValue::parse(std::string("{\"a\": [1, 2, 3]}"), options);
+
+    // Elements of packed arrays can be patched like any others.
+    auto document = packed;
+    jsonpp::patch::apply(document, parse("[ \
+        {\"op\": \"test\", \"path\": \"/a/1\", \"value\": 2}, \
+        {\"op\": \"replace\", \"path\": \"/a/0\", \"value\": 9}, \
+        {\"op\": \"copy\", \"from\": \"/a/2\", \"path\": \"/b\"}, \
+        {\"op\": \"remove\", \"path\": \"/a/1\"}, \
+        {\"op\": \"add\", \"path\": \"/a/-\", \"value\": \"x\"} \
+    ]"));
+    assert_value_eq(document, parse("{\"a\": [9, 3, \"x\"], \"b\": 3}"));
+    const auto &original = std::get<jsonpp::JsonObject>(packed.value()->get()).at("a");
+    ASSERT_TRUE(std::holds_alternative<jsonpp::JsonNumberArray>(original.value()->get()));
+    ASSERT_THROW(jsonpp::patch::apply(document, parse("[{\"op\": \"test\", \"path\": \"/a/0\", \"value\": 1}]")), std::runtime_error);
+
+    // Packed arrays are diffed element by element, against packed or boxed arrays.
+    auto expected = parse("[{\"op\": \"replace\", \"path\": \"/a/1\", \"value\": 5}]");
+    auto changed = jsonpp::JsonValue::parse(std::string("{\"a\": [1, 5, 3]}"), options);
+    assert_value_eq(jsonpp::patch::diff(packed, changed), expected);
+    assert_value_eq(jsonpp::patch::diff(packed, parse("{\"a\": [1, 5, 3]}")), expected);
+    assert_value_eq(jsonpp::patch::diff(parse("{\"a\": [1, 2, 3]}"), changed), expected);
+    assert_value_eq(jsonpp::patch::diff(packed, parse("{\"a\": [1, 2, 3]}")), parse("[]"));
+};
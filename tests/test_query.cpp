@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+
+#include "lib.hpp"
+#include "query.hpp"
+#include "test_utils.hpp"
+
+static const char *EVENT = "{\"payload\": {\"items\": [1, {\"x\": [true]}, \"a\\\"]\"]}, \
+                             \"meta\": {\"trace_id\": \"abc\", \"tags\": [\"t1\", \"t2\"]}, \
+                             \"a/b\": 1, \"m~n\": 2}";
+
+TEST(QueryTest, PointerEvaluate)
+{
+    auto doc = jsonpp::JsonValue::parse(EVENT);
+
+    assert_value_eq(jsonpp::JsonPointer::parse("/meta/trace_id").evaluate(doc).value(), jsonpp::JsonValue(std::string("abc")));
+    assert_value_eq(jsonpp::JsonPointer::parse("/meta/tags/1").evaluate(doc).value(), jsonpp::JsonValue(std::string("t2")));
+    assert_value_eq(jsonpp::JsonPointer::parse("/a~1b").evaluate(doc).value(), jsonpp::JsonValue(1.));
+    assert_value_eq(jsonpp::JsonPointer::parse("/m~0n").evaluate(doc).value(), jsonpp::JsonValue(2.));
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/meta/tags/2").evaluate(doc).has_value());
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/meta/tags/01").evaluate(doc).has_value());
+    // 2^64 + 1 would wrap around to 1.
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/meta/tags/18446744073709551617").evaluate(doc).has_value());
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/meta/tags/18446744073709551617").extract(EVENT).has_value());
+    ASSERT_FALSE(jsonpp::PathMatcher::compile({jsonpp::JsonPointer::parse("/meta/tags/18446744073709551617")}).extract(EVENT)[0].has_value());
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/missing").evaluate(doc).has_value());
+};
+
+TEST(QueryTest, PointerExtract)
+{
+    assert_value_eq(jsonpp::JsonPointer::parse("/meta/trace_id").extract(EVENT).value(), jsonpp::JsonValue(std::string("abc")));
+    assert_value_eq(jsonpp::JsonPointer::parse("/payload/items/1/x").extract(EVENT).value(), jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(true)}));
+    assert_value_eq(jsonpp::JsonPointer::parse("/m~0n").extract(EVENT).value(), jsonpp::JsonValue(2.));
+    assert_value_eq(jsonpp::JsonPointer::parse("").extract("[null]").value(), jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(nullptr)}));
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/payload/items/3").extract(EVENT).has_value());
+    ASSERT_FALSE(jsonpp::JsonPointer::parse("/meta/trace_id/x").extract(EVENT).has_value());
+};
+
+TEST(QueryTest, PointerExtractStopsAtMatch)
+{
+    // Everything after the match is never looked at.
+    assert_value_eq(jsonpp::JsonPointer::parse("/a").extract("{\"skip\": {\"x\": [\"]}\"]}, \"a\": 1, ???").value(), jsonpp::JsonValue(1.));
+    ASSERT_ANY_THROW(jsonpp::JsonPointer::parse("/b").extract("{\"a\": 1, ???"));
+
+    // Skipped values still need brackets of the right kind.
+    ASSERT_ANY_THROW(jsonpp::JsonPointer::parse("/1").extract("[[1}, 2]"));
+    ASSERT_ANY_THROW(jsonpp::JsonPointer::parse("/b").extract("{\"a\": {\"x\": [1}}, \"b\": 1}"));
+};
+
+TEST(QueryTest, InvalidPointer)
+{
+    ASSERT_ANY_THROW(jsonpp::JsonPointer::parse("meta"));
+    ASSERT_ANY_THROW(jsonpp::JsonPointer::parse("/a~2"));
+};
+
+TEST(QueryTest, PathWildcard)
+{
+    auto path = jsonpp::JsonPath::parse("$.meta.tags[*]");
+    auto expected = std::vector<jsonpp::JsonValue>{jsonpp::JsonValue(std::string("t1")), jsonpp::JsonValue(std::string("t2"))};
+
+    auto extracted = path.extract(EVENT);
+    ASSERT_EQ(extracted.size(), expected.size());
+    for (size_t i = 0; i < extracted.size(); ++i)
+    {
+        assert_value_eq(extracted[i], expected[i]);
+    }
+
+    auto evaluated = path.evaluate(jsonpp::JsonValue::parse(EVENT));
+    ASSERT_EQ(evaluated.size(), expected.size());
+};
+
+TEST(QueryTest, PathMembersAndIndices)
+{
+    auto extracted = jsonpp::JsonPath::parse("$['payload'].items[1].*[0]").extract(EVENT);
+    ASSERT_EQ(extracted.size(), 1);
+    assert_value_eq(extracted[0], jsonpp::JsonValue(true));
+
+    ASSERT_TRUE(jsonpp::JsonPath::parse("$.meta.nope").extract(EVENT).empty());
+    ASSERT_TRUE(jsonpp::JsonPath::parse("$.meta.tags[2]").evaluate(jsonpp::JsonValue::parse(EVENT)).empty());
+    ASSERT_EQ(jsonpp::JsonPath::parse("$.meta.tags[1]").evaluate(jsonpp::JsonValue::parse(EVENT)).size(), 1);
+    ASSERT_ANY_THROW(jsonpp::JsonPath::parse("$..tags"));
+    ASSERT_ANY_THROW(jsonpp::JsonPath::parse("meta"));
+};
+
+TEST(QueryTest, PathMatcherExtract)
+{
+    auto matcher = jsonpp::PathMatcher::compile({
+        jsonpp::JsonPointer::parse("/meta/trace_id"),
+        jsonpp::JsonPointer::parse("/payload/items/0"),
+        jsonpp::JsonPointer::parse("/meta/missing"),
+        jsonpp::JsonPointer::parse("/meta"),
+        jsonpp::JsonPointer::parse("/meta/tags/1"),
+        jsonpp::JsonPointer::parse("/m~0n"),
+        jsonpp::JsonPointer::parse("/meta/trace_id"),
+    });
+
+    auto results = matcher.extract(EVENT);
+    ASSERT_EQ(results.size(), 7);
+    assert_value_eq(results[0].value(), jsonpp::JsonValue(std::string("abc")));
+    assert_value_eq(results[1].value(), jsonpp::JsonValue(1.));
+    ASSERT_FALSE(results[2].has_value());
+    assert_value_eq(results[3].value(), jsonpp::JsonPointer::parse("/meta").evaluate(jsonpp::JsonValue::parse(EVENT)).value());
+    assert_value_eq(results[4].value(), jsonpp::JsonValue(std::string("t2")));
+    assert_value_eq(results[5].value(), jsonpp::JsonValue(2.));
+    assert_value_eq(results[6].value(), jsonpp::JsonValue(std::string("abc")));
+};
+
+TEST(QueryTest, PathMatcherLocate)
+{
+    auto matcher = jsonpp::PathMatcher::compile({
+        jsonpp::JsonPointer::parse("/meta"),
+        jsonpp::JsonPointer::parse("/meta/tags/1"),
+        jsonpp::JsonPointer::parse("/payload/items/1"),
+        jsonpp::JsonPointer::parse("/meta/missing"),
+    });
+
+    auto results = matcher.locate(EVENT);
+    ASSERT_EQ(results[0].value(), "{\"trace_id\": \"abc\", \"tags\": [\"t1\", \"t2\"]}");
+    ASSERT_EQ(results[1].value(), "\"t2\"");
+    ASSERT_EQ(results[2].value(), "{\"x\": [true]}");
+    ASSERT_FALSE(results[3].has_value());
+};
+
+TEST(QueryTest, PathMatcherStopsWhenResolved)
+{
+    auto matcher = jsonpp::PathMatcher::compile({
+        jsonpp::JsonPointer::parse("/a/x"),
+        jsonpp::JsonPointer::parse("/a/y"),
+        jsonpp::JsonPointer::parse("/b/0"),
+    });
+
+    // "/a/y" is resolved as missing once "a" closes and scanning ends right after "/b/0".
+    auto results = matcher.extract("{\"a\": {\"x\": 1, \"z\": [2, 3]}, \"c\": 0, \"a\": {\"y\": 4}, \"b\": [5, ???");
+    assert_value_eq(results[0].value(), jsonpp::JsonValue(1.));
+    ASSERT_FALSE(results[1].has_value());
+    assert_value_eq(results[2].value(), jsonpp::JsonValue(5.));
+};
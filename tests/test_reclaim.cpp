@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "lib.hpp"
+#include "reclaim.hpp"
+
+TEST(ReclaimTest, DisposeAndFlush)
+{
+    auto reclaimer = jsonpp::reclaim::Reclaimer();
+    for (int i = 0; i < 100; ++i)
+    {
+        reclaimer.dispose(jsonpp::JsonValue::parse("{\"a\": [1, 2, 3], \"b\": {\"c\": \"d\"}}"));
+        reclaimer.dispose(jsonpp::JsonValue::parse("\"scalar\""));
+        reclaimer.dispose(nullptr);
+    }
+    reclaimer.flush();
+    // Nothing left to wait for.
+    reclaimer.flush();
+}
+
+TEST(ReclaimTest, SharedValuesSurvive)
+{
+    auto value = jsonpp::JsonValue::parse("{\"a\": [1, 2, 3], \"b\": {\"c\": \"d\"}}");
+    auto expected = value.json();
+    {
+        auto reclaimer = jsonpp::reclaim::Reclaimer();
+        reclaimer.dispose(value);
+        reclaimer.flush();
+    }
+    ASSERT_EQ(value.json(), expected);
+}
+
+TEST(ReclaimTest, DestructorDrainsQueue)
+{
+    auto depth = 50000;
+    auto json = std::string();
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "[";
+    }
+    for (int i = 0; i < depth; ++i)
+    {
+        json += "]";
+    }
+
+    auto reclaimer = jsonpp::reclaim::Reclaimer();
+    auto options = jsonpp::ParseOptions{};
+    options.pack_number_arrays = true;
+    reclaimer.dispose(jsonpp::JsonValue::parse(json));
+    reclaimer.dispose(jsonpp::JsonValue::parse("[1, 2, 3]", options));
+}
@@ -0,0 +1,119 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include "lib.hpp"
+#include "schema.hpp"
+#include "test_utils.hpp"
+
+static const char *SCHEMA = R"({
+    "title": "request",
+    "type": "object",
+    "required": ["id", "kind"],
+    "properties": {
+        "id": {"type": "integer", "minimum": 1},
+        "kind": {"enum": ["get", "put", null]},
+        "name": {"type": "string", "maxLength": 3},
+        "ratio": {"type": ["number", "null"], "minimum": 0, "maximum": 1},
+        "tags": {"type": "array", "items": {"type": "string"}},
+        "flag": {"type": "boolean", "enum": [true]},
+        "any": true
+    }
+})";
+
+TEST(SchemaTest, ValidatesText)
+{
+    auto schema = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(SCHEMA));
+
+    for (auto valid : {
+             R"({"id": 1, "kind": "get"})",
+             R"({"kind": null, "id": 2e3, "name": "aé\n", "ratio": 0.5, "tags": [], "extra": [{}]})",
+             R"({"id": 7, "kind": "put", "ratio": null, "tags": ["x", "y"], "flag": true, "any": [1, {"a": null}]})",
+             R"({"id": 1, "kind": "get", "name": "😀ab"})",
+         })
+    {
+        ASSERT_NO_THROW(schema.scan(valid)) << valid;
+        ASSERT_NO_THROW(schema.validate(jsonpp::JsonValue::parse(valid))) << valid;
+    }
+
+    for (auto invalid : {
+             R"([])",
+             R"({"id": 1})",
+             R"({"id": 1.5, "kind": "get"})",
+             R"({"id": 0, "kind": "get"})",
+             R"({"id": 1, "kind": "post"})",
+             R"({"id": 1, "kind": "get", "name": "abcd"})",
+             R"({"id": 1, "kind": "get", "ratio": 2})",
+             R"({"id": 1, "kind": "get", "tags": ["x", 1]})",
+             R"({"id": 1, "kind": "get", "flag": false})",
+             R"({"id": 1, "kind": {}})",
+             R"({"id": 1, "kind": "get", "tags": [})",
+         })
+    {
+        ASSERT_THROW(schema.scan(invalid), std::runtime_error) << invalid;
+    }
+};
+
+TEST(SchemaTest, ValidatesWhileParsing)
+{
+    auto schema = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(SCHEMA));
+    auto options = jsonpp::ParseOptions{};
+    options.schema = &schema;
+
+    auto json = std::string(R"({"id": 3, "kind": "get", "tags": ["a"], "ratio": 1})");
+    assert_value_eq(jsonpp::JsonValue::parse(json, options), jsonpp::JsonValue::parse(json));
+
+    // Rejected as soon as the violating value is complete, before the rest arrives.
+    auto parser = jsonpp::Parser(options);
+    parser.feed(R"({"id": 3, "tags": ["a", )");
+    ASSERT_THROW(parser.feed("2,"), std::runtime_error);
+
+    auto missing = jsonpp::Parser(options);
+    missing.feed(R"({"id": 3)");
+    ASSERT_THROW(missing.feed("}"), std::runtime_error);
+
+    // Packed arrays and raw values are validated too.
+    auto numbers = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(R"({"items": {"maximum": 10}})"));
+    options.schema = &numbers;
+    options.pack_number_arrays = true;
+    ASSERT_NO_THROW(jsonpp::JsonValue::parse("[1, 2, 10]", options));
+    ASSERT_THROW(jsonpp::JsonValue::parse("[1, 11, 2]", options), std::runtime_error);
+    options.raw_depth = 1;
+    ASSERT_THROW(jsonpp::JsonValue::parse("[1, \"a\", 11]", options), std::runtime_error);
+};
+
+TEST(SchemaTest, CompileErrors)
+{
+    for (auto invalid : {
+             R"(1)",
+             R"({"type": "float"})",
+             R"({"pattern": "a*"})",
+             R"({"required": "id"})",
+             R"({"enum": [[1]]})",
+             R"({"maxLength": -1})",
+             R"({"properties": {"a": 1}})",
+         })
+    {
+        ASSERT_THROW(jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse(invalid)), std::runtime_error) << invalid;
+    }
+
+    auto never = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse("false"));
+    ASSERT_THROW(never.scan("null"), std::runtime_error);
+    auto always = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse("{\"description\": \"x\"}"));
+    ASSERT_NO_THROW(always.scan("[1, {\"a\": null}]"));
+    // A std::string picks an overload without a cast.
+    ASSERT_THROW(never.scan(std::string("null")), std::runtime_error);
+    ASSERT_THROW(never.validate(std::string("null")), std::runtime_error);
+};
+
+TEST(SchemaTest, DeepValue)
+{
+    // Deep enough to overflow the stack if feeding a parsed value recursed.
+    auto depth = 40000;
+    auto json = std::string(depth, '[') + "1" + std::string(depth, ']');
+    auto value = jsonpp::JsonValue::parse(json);
+    auto schema = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse("{\"items\": {\"items\": {\"type\": \"array\"}}}"));
+    ASSERT_NO_THROW(schema.validate(value));
+    auto shallow = jsonpp::schema::Schema::compile(jsonpp::JsonValue::parse("{\"items\": {\"items\": {\"type\": \"number\"}}}"));
+    ASSERT_THROW(shallow.validate(value), std::runtime_error);
+};
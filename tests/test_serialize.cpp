@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "lib.hpp"
+#include "serialize.hpp"
+
+static const char *DOCUMENT = "{\"a\": [1, -2.5, 1e300, true, null, \"x\\\"y\"], \"b\": {\"c\": {}, \"d\": []}, \"e\": \"a long string value\"}";
+
+TEST(SerializeTest, MatchesJson)
+{
+    auto options = jsonpp::ParseOptions{};
+    for (auto packed : {false, true})
+    {
+        options.pack_number_arrays = packed;
+        options.raw_pointers = packed ? std::vector<std::string>{"/b"} : std::vector<std::string>{};
+        auto value = jsonpp::JsonValue::parse(DOCUMENT, options);
+        auto expected = value.json();
+
+        // Every buffer size, down to one byte, gives the same text.
+        for (std::size_t buffer_size = 1; buffer_size <= expected.size() + 1; ++buffer_size)
+        {
+            auto out = std::string();
+            auto chunks = 0;
+            auto serializer = jsonpp::serialize::Serializer(
+                value,
+                [&](std::string_view chunk)
+                {
+                    EXPECT_LE(chunk.size(), buffer_size);
+                    out.append(chunk);
+                    ++chunks;
+                    return chunk.size();
+                },
+                buffer_size);
+            ASSERT_TRUE(serializer.write());
+            ASSERT_TRUE(serializer.done());
+            ASSERT_EQ(out, expected);
+            ASSERT_EQ(chunks, (expected.size() + buffer_size - 1) / buffer_size);
+        }
+    }
+
+    for (auto scalar : {"null", "12", "\"s\"", "[]", "{}"})
+    {
+        auto out = std::ostringstream();
+        jsonpp::serialize::write(jsonpp::JsonValue::parse(scalar), out, 4);
+        ASSERT_EQ(out.str(), scalar);
+    }
+};
+
+TEST(SerializeTest, Backpressure)
+{
+    auto value = jsonpp::JsonValue::parse(DOCUMENT);
+    auto expected = value.json();
+
+    // The sink takes at most three bytes per call, and nothing on every other call.
+    auto out = std::string();
+    auto calls = 0;
+    auto serializer = jsonpp::serialize::Serializer(
+        value,
+        [&](std::string_view chunk) -> std::size_t
+        {
+            if (calls++ % 2)
+            {
+                return 0;
+            }
+            auto n = std::min<std::size_t>(chunk.size(), 3);
+            out.append(chunk.substr(0, n));
+            return n;
+        },
+        16);
+
+    auto rounds = 0;
+    while (!serializer.write())
+    {
+        ASSERT_FALSE(serializer.done());
+        ++rounds;
+    }
+    ASSERT_TRUE(serializer.done());
+    ASSERT_EQ(out, expected);
+    ASSERT_GT(rounds, expected.size() / 3);
+    ASSERT_TRUE(serializer.write());
+};
+
+TEST(SerializeTest, FileDescriptor)
+{
+    auto value = jsonpp::JsonValue::parse(DOCUMENT);
+    auto file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    jsonpp::serialize::write(value, fileno(file), 8);
+
+    std::rewind(file);
+    auto out = std::string(value.json().size() + 1, '\0');
+    out.resize(std::fread(out.data(), 1, out.size(), file));
+    std::fclose(file);
+    ASSERT_EQ(out, value.json());
+
+    ASSERT_THROW(jsonpp::serialize::write(value, -1), std::runtime_error);
+};
@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+#include "lib.hpp"
+#include "typed.hpp"
+#include "test_utils.hpp"
+
+struct Address
+{
+    std::string city;
+    std::optional<int> zip;
+};
+
+struct User
+{
+    std::string name;
+    double score = 0;
+    int64_t id = 0;
+    bool admin = false;
+    std::vector<std::string> tags;
+    std::optional<Address> address;
+    jsonpp::JsonValue extra = nullptr;
+};
+
+template <>
+struct jsonpp::JsonFields<Address>
+{
+    static constexpr auto fields = std::make_tuple(
+        jsonpp::field("city", &Address::city),
+        jsonpp::field("zip", &Address::zip));
+};
+
+template <>
+struct jsonpp::JsonFields<User>
+{
+    static constexpr auto fields = std::make_tuple(
+        jsonpp::field("name", &User::name),
+        jsonpp::field("score", &User::score),
+        jsonpp::field("id", &User::id),
+        jsonpp::field("admin", &User::admin),
+        jsonpp::field("tags", &User::tags),
+        jsonpp::field("address", &User::address),
+        jsonpp::field("extra", &User::extra));
+};
+
+TEST(TypedTest, ParseStruct)
+{
+    auto user = jsonpp::parse_as<User>(
+        "{\"id\": 42, \"name\": \"ada\", \"unknown\": {\"x\": [1, 2]}, \"score\": 1.5e2, \
+          \"admin\": true, \"tags\": [\"a\", \"b\"], \"address\": {\"city\": \"x\", \"zip\": null}, \
+          \"extra\": [null], \"name\": \"ignored\"}");
+
+    ASSERT_EQ(user.name, "ada");
+    ASSERT_EQ(user.score, 150.);
+    ASSERT_EQ(user.id, 42);
+    ASSERT_TRUE(user.admin);
+    ASSERT_EQ(user.tags, (std::vector<std::string>{"a", "b"}));
+    ASSERT_TRUE(user.address.has_value());
+    ASSERT_EQ(user.address->city, "x");
+    ASSERT_FALSE(user.address->zip.has_value());
+    assert_value_eq(user.extra, jsonpp::JsonValue(jsonpp::JsonArray{jsonpp::JsonValue(nullptr)}));
+};
+
+TEST(TypedTest, MissingMembersKeepDefaults)
+{
+    auto user = jsonpp::parse_as<User>("{\"address\": null}");
+    ASSERT_EQ(user.name, "");
+    ASSERT_EQ(user.id, 0);
+    ASSERT_FALSE(user.address.has_value());
+};
+
+TEST(TypedTest, ShapeMismatch)
+{
+    ASSERT_ANY_THROW(jsonpp::parse_as<User>("[]"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<User>("{\"id\": 1.5}"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<User>("{\"name\": 1}"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<User>("{\"admin\": null}"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<User>("{} {}"));
+
+    // Skipped members are validated like the rest of the document.
+    ASSERT_ANY_THROW(jsonpp::parse_as<Address>("{\"x\": [}, \"city\": \"a\"}"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<Address>("{\"x\": {\"y\" 1}, \"city\": \"a\"}"));
+    ASSERT_ANY_THROW(jsonpp::parse_as<Address>("{\"city\": \"a\", \"city\": [1 2]}"));
+};
+
+TEST(TypedTest, WriteStruct)
+{
+    auto address = Address{"x", 12345};
+    ASSERT_EQ(jsonpp::to_json(address), "{\"city\":\"x\",\"zip\":12345}");
+
+    auto user = User{"ada", 0.5, -7, true, {"a", "b"}, std::nullopt, nullptr};
+    ASSERT_EQ(jsonpp::to_json(user), "{\"name\":\"ada\",\"score\":0.5,\"id\":-7,\"admin\":true,\"tags\":[\"a\",\"b\"],\"address\":null,\"extra\":null}");
+};
+
+TEST(TypedTest, RoundTripStruct)
+{
+    auto user = User{"ada", 1e-7, 1234567890123, false, {}, Address{"y", std::nullopt}, nullptr};
+    auto parsed = jsonpp::parse_as<User>(jsonpp::to_json(user));
+    ASSERT_EQ(parsed.name, user.name);
+    ASSERT_EQ(parsed.score, user.score);
+    ASSERT_EQ(parsed.id, user.id);
+    ASSERT_EQ(parsed.admin, user.admin);
+    ASSERT_EQ(parsed.address->city, "y");
+};
+
+TEST(TypedTest, BoolVector)
+{
+    auto flags = jsonpp::parse_as<std::vector<bool>>("[true, false, true]");
+    ASSERT_EQ(flags, (std::vector<bool>{true, false, true}));
+    ASSERT_EQ(jsonpp::to_json(flags), "[true,false,true]");
+    ASSERT_ANY_THROW(jsonpp::parse_as<std::vector<bool>>("[true, 1]"));
+};
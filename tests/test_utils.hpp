@@ -0,0 +1,89 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "lib.hpp"
+
+void assert_value_eq(const jsonpp::JsonValue &actual, const jsonpp::JsonValue &expected);
+
+struct Visitor
+{
+    void operator()(const bool &actual, const bool &expected) const
+    {
+        ASSERT_EQ(actual, expected);
+    }
+
+    void operator()(const double &actual, const double &expected) const
+    {
+        ASSERT_EQ(actual, expected);
+    }
+
+    void operator()(const std::string &actual, const std::string &expected) const
+    {
+        ASSERT_EQ(actual, expected);
+    }
+
+    void operator()(const jsonpp::JsonArray &actual, const jsonpp::JsonArray &expected) const
+    {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (int i = 0; i < actual.size(); ++i)
+        {
+            assert_value_eq(actual[i], expected[i]);
+        }
+    }
+
+    void operator()(const jsonpp::JsonNumberArray &actual, const jsonpp::JsonNumberArray &expected) const
+    {
+        ASSERT_EQ(actual, expected);
+    }
+
+    void operator()(const jsonpp::JsonRaw &actual, const jsonpp::JsonRaw &expected) const
+    {
+        ASSERT_EQ(actual.text, expected.text);
+    }
+
+    void operator()(const jsonpp::JsonObject &actual, const jsonpp::JsonObject &expected) const
+    {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (const auto &[key, value] : actual)
+        {
+            auto it = expected.find(key);
+            ASSERT_NE(it, expected.end()) << "Actual contains key not in expected";
+            assert_value_eq(value, it->second);
+        }
+    }
+
+    template <typename T, typename U>
+    void operator()(const T &actual, const U &expected) const
+    {
+        FAIL() << "Actual (" << jsonpp::ToJsonVisitor{}(actual) << ") has different type than expected (" << jsonpp::ToJsonVisitor{}(expected) << ")";
+    }
+};
+
+inline void assert_variant_eq(const jsonpp::JsonValueVariant &actual, const jsonpp::JsonValueVariant &expected)
+{
+    std::visit(Visitor{}, actual, expected);
+}
+
+inline void assert_value_eq(const jsonpp::JsonValue &actual, const jsonpp::JsonValue &expected)
+{
+    auto expected_value = expected.value();
+    if (expected_value)
+    {
+        auto expected_variant = expected_value->get();
+        auto actual_value = actual.value();
+        if (actual_value)
+        {
+            auto actual_variant = actual_value->get();
+            assert_variant_eq(actual_variant, expected_variant);
+        }
+        else
+        {
+            FAIL() << "Expected non-null";
+        }
+    }
+    else
+    {
+        ASSERT_FALSE(actual.value().has_value()) << "Expected null";
+    }
+}